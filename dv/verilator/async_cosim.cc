@@ -0,0 +1,259 @@
+// Copyright lowRISC contributors.
+// Licensed under the Apache License, Version 2.0, see LICENSE for details.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "async_cosim.h"
+
+#include "verilator_sim_ctrl.h"
+
+// Polls of an empty or full ring buffer before yielding the CPU. The worker is
+// meant to have a core of its own, spinning keeps its latency low.
+static const unsigned kSpinsBeforeYield = 1000;
+
+AsyncCosim::AsyncCosim(std::unique_ptr<Cosim> cosim, VerilatorSimCtrl &simctrl)
+    : cosim_(std::move(cosim)),
+      simctrl_(simctrl),
+      records_(kNumRecords),
+      head_(0),
+      tail_(0),
+      push_head_(0),
+      cached_tail_(0),
+      stop_(false),
+      failed_(false),
+      mismatch_cycle_(0),
+      mismatch_pc_(0) {
+  worker_ = std::thread(&AsyncCosim::Work, this);
+}
+
+AsyncCosim::~AsyncCosim() {
+  // The worker applies the remaining records before it stops
+  Publish();
+  stop_.store(true, std::memory_order_release);
+  worker_.join();
+}
+
+AsyncCosim::Record &AsyncCosim::Push(Record::Op op) {
+  if (push_head_ - cached_tail_ == kNumRecords) {
+    // Full, let the worker apply the records pushed so far
+    Publish();
+    unsigned spins = 0;
+    while ((cached_tail_ = tail_.load(std::memory_order_acquire)) +
+               kNumRecords ==
+           push_head_) {
+      if (++spins >= kSpinsBeforeYield) {
+        std::this_thread::yield();
+      }
+    }
+  }
+
+  Record &record = records_[push_head_++ & (kNumRecords - 1)];
+  record.op = op;
+  return record;
+}
+
+void AsyncCosim::Drain() {
+  Publish();
+  unsigned spins = 0;
+  while (tail_.load(std::memory_order_acquire) != push_head_) {
+    if (++spins >= kSpinsBeforeYield) {
+      std::this_thread::yield();
+    }
+  }
+  cached_tail_ = push_head_;
+}
+
+void AsyncCosim::Work() {
+  uint64_t tail = tail_.load(std::memory_order_relaxed);
+  unsigned spins = 0;
+  while (1) {
+    uint64_t head = head_.load(std::memory_order_acquire);
+    if (tail == head) {
+      if (stop_.load(std::memory_order_acquire) &&
+          head_.load(std::memory_order_acquire) == tail) {
+        return;
+      }
+      if (++spins >= kSpinsBeforeYield) {
+        std::this_thread::yield();
+      }
+      continue;
+    }
+
+    spins = 0;
+    for (; tail != head; ++tail) {
+      // Spike's state is meaningless after a mismatch, drop the records
+      if (!failed_.load(std::memory_order_relaxed)) {
+        Apply(records_[tail & (kNumRecords - 1)]);
+      }
+    }
+    tail_.store(tail, std::memory_order_release);
+  }
+}
+
+void AsyncCosim::Apply(const Record &record) {
+  switch (record.op) {
+    case Record::kStep:
+      if (!cosim_->step(record.a, record.b, record.c, record.flag_a,
+                        record.flag_b)) {
+        mismatch_cycle_ = record.wide;
+        mismatch_pc_ = record.c;
+        mismatch_errors_ = cosim_->get_errors();
+        cosim_->clear_errors();
+        failed_.store(true, std::memory_order_release);
+      }
+      break;
+    case Record::kSetMip:
+      cosim_->set_mip(record.a, record.b);
+      break;
+    case Record::kSetNmi:
+      cosim_->set_nmi(record.flag_a);
+      break;
+    case Record::kSetNmiInt:
+      cosim_->set_nmi_int(record.flag_a);
+      break;
+    case Record::kSetDebugReq:
+      cosim_->set_debug_req(record.flag_a);
+      break;
+    case Record::kSetMcycle:
+      cosim_->set_mcycle(record.wide);
+      break;
+    case Record::kSetCsr:
+      cosim_->set_csr(record.a, record.b);
+      break;
+    case Record::kSetIcScrKeyValid:
+      cosim_->set_ic_scr_key_valid(record.flag_a);
+      break;
+    case Record::kNotifyDsideAccess:
+      cosim_->notify_dside_access(record.access_info);
+      break;
+    case Record::kSetIsideError:
+      cosim_->set_iside_error(record.a);
+      break;
+  }
+}
+
+void AsyncCosim::GetMismatch(uint64_t &cycle, uint32_t &pc,
+                             std::vector<std::string> &errors) const {
+  cycle = mismatch_cycle_;
+  pc = mismatch_pc_;
+  errors = mismatch_errors_;
+}
+
+bool AsyncCosim::step(uint32_t write_reg, uint32_t write_reg_data,
+                      uint32_t pc, bool sync_trap, bool suppress_reg_write) {
+  Record &record = Push(Record::kStep);
+  record.a = write_reg;
+  record.b = write_reg_data;
+  record.c = pc;
+  record.flag_a = sync_trap;
+  record.flag_b = suppress_reg_write;
+  record.wide = simctrl_.GetTime() / 2;
+  Publish();
+  return true;
+}
+
+void AsyncCosim::set_mip(uint32_t pre_mip, uint32_t post_mip) {
+  Record &record = Push(Record::kSetMip);
+  record.a = pre_mip;
+  record.b = post_mip;
+}
+
+void AsyncCosim::set_nmi(bool nmi) { Push(Record::kSetNmi).flag_a = nmi; }
+
+void AsyncCosim::set_nmi_int(bool nmi_int) {
+  Push(Record::kSetNmiInt).flag_a = nmi_int;
+}
+
+void AsyncCosim::set_debug_req(bool debug_req) {
+  Push(Record::kSetDebugReq).flag_a = debug_req;
+}
+
+void AsyncCosim::set_mcycle(uint64_t mcycle) {
+  Push(Record::kSetMcycle).wide = mcycle;
+}
+
+void AsyncCosim::set_csr(const int csr_num, const uint32_t new_val) {
+  Record &record = Push(Record::kSetCsr);
+  record.a = csr_num;
+  record.b = new_val;
+}
+
+void AsyncCosim::set_ic_scr_key_valid(bool valid) {
+  Push(Record::kSetIcScrKeyValid).flag_a = valid;
+}
+
+void AsyncCosim::notify_dside_access(const DSideAccessInfo &access_info) {
+  Push(Record::kNotifyDsideAccess).access_info = access_info;
+}
+
+void AsyncCosim::set_iside_error(uint32_t addr) {
+  Push(Record::kSetIsideError).a = addr;
+}
+
+void AsyncCosim::add_memory(uint32_t base_addr, size_t size) {
+  Drain();
+  cosim_->add_memory(base_addr, size);
+}
+
+void AsyncCosim::add_shared_memory(uint32_t base_addr, size_t size,
+                                   uint8_t *data) {
+  Drain();
+  cosim_->add_shared_memory(base_addr, size, data);
+}
+
+void AsyncCosim::add_mmio_region(uint32_t base_addr, size_t size) {
+  Drain();
+  cosim_->add_mmio_region(base_addr, size);
+}
+
+bool AsyncCosim::backdoor_write_mem(uint32_t addr, size_t len,
+                                    const uint8_t *data_in) {
+  Drain();
+  return cosim_->backdoor_write_mem(addr, len, data_in);
+}
+
+bool AsyncCosim::backdoor_read_mem(uint32_t addr, size_t len,
+                                   uint8_t *data_out) {
+  Drain();
+  return cosim_->backdoor_read_mem(addr, len, data_out);
+}
+
+void AsyncCosim::set_minstret(uint64_t minstret) {
+  Drain();
+  cosim_->set_minstret(minstret);
+}
+
+void AsyncCosim::set_arch_state(uint32_t pc, const uint32_t gprs[32]) {
+  Drain();
+  cosim_->set_arch_state(pc, gprs);
+}
+
+void AsyncCosim::get_arch_state(uint32_t &pc, uint32_t gprs[32]) {
+  Drain();
+  cosim_->get_arch_state(pc, gprs);
+}
+
+uint32_t AsyncCosim::get_csr(const int csr_num) {
+  Drain();
+  return cosim_->get_csr(csr_num);
+}
+
+const std::vector<std::string> &AsyncCosim::get_errors() {
+  Drain();
+  return cosim_->get_errors();
+}
+
+void AsyncCosim::clear_errors() {
+  Drain();
+  cosim_->clear_errors();
+}
+
+unsigned int AsyncCosim::get_insn_cnt() {
+  Drain();
+  return cosim_->get_insn_cnt();
+}
+
+uint64_t AsyncCosim::free_run(uint64_t max_steps, bool stop_at_pc,
+                              uint32_t stop_pc) {
+  Drain();
+  return cosim_->free_run(max_steps, stop_at_pc, stop_pc);
+}
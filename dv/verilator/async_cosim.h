@@ -0,0 +1,151 @@
+// Copyright lowRISC contributors.
+// Licensed under the Apache License, Version 2.0, see LICENSE for details.
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef ASYNC_COSIM_H_
+#define ASYNC_COSIM_H_
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "cosim.h"
+
+class VerilatorSimCtrl;
+
+/**
+ * Co-simulator stepped on a worker thread
+ *
+ * Wraps a co-simulator, e.g. SpikeCosim, so the checker doesn't wait for it.
+ * The calls of the checker are pushed into a single-producer single-consumer
+ * ring buffer and applied in order by a worker thread, so the simulation and
+ * the co-simulator run in parallel and the slower of both sets the pace.
+ *
+ * step() always succeeds. A mismatch is found later by the worker, which then
+ * stops stepping; see Failed() and GetMismatch(). Calls which aren't made for
+ * every instruction, e.g. backdoor_write_mem(), wait for the worker to apply
+ * the calls before them and are then made directly.
+ */
+class AsyncCosim : public Cosim {
+ public:
+  /**
+   * @param cosim Co-simulator to step on the worker thread
+   * @param simctrl Simulation controller to get the cycle of each step from
+   */
+  AsyncCosim(std::unique_ptr<Cosim> cosim, VerilatorSimCtrl &simctrl);
+  ~AsyncCosim();
+
+  /**
+   * Wait until the worker applied all calls made so far
+   */
+  void Drain();
+
+  /**
+   * Has the worker found a mismatch?
+   */
+  bool Failed() const { return failed_.load(std::memory_order_acquire); }
+
+  /**
+   * Get the first mismatch, only valid once Failed() returned true
+   *
+   * @param cycle The cycle in which the mismatching instruction retired
+   * @param pc The PC of the mismatching instruction
+   * @param errors The errors reported by the co-simulator
+   */
+  void GetMismatch(uint64_t &cycle, uint32_t &pc,
+                   std::vector<std::string> &errors) const;
+
+  // Declared in Cosim
+  void add_memory(uint32_t base_addr, size_t size) override;
+  void add_shared_memory(uint32_t base_addr, size_t size,
+                         uint8_t *data) override;
+  void add_mmio_region(uint32_t base_addr, size_t size) override;
+  bool backdoor_write_mem(uint32_t addr, size_t len,
+                          const uint8_t *data_in) override;
+  bool backdoor_read_mem(uint32_t addr, size_t len, uint8_t *data_out) override;
+  bool step(uint32_t write_reg, uint32_t write_reg_data, uint32_t pc,
+            bool sync_trap, bool suppress_reg_write) override;
+  void set_mip(uint32_t pre_mip, uint32_t post_mip) override;
+  void set_nmi(bool nmi) override;
+  void set_nmi_int(bool nmi_int) override;
+  void set_debug_req(bool debug_req) override;
+  void set_mcycle(uint64_t mcycle) override;
+  void set_minstret(uint64_t minstret) override;
+  void set_arch_state(uint32_t pc, const uint32_t gprs[32]) override;
+  void get_arch_state(uint32_t &pc, uint32_t gprs[32]) override;
+  void set_csr(const int csr_num, const uint32_t new_val) override;
+  uint32_t get_csr(const int csr_num) override;
+  void set_ic_scr_key_valid(bool valid) override;
+  void notify_dside_access(const DSideAccessInfo &access_info) override;
+  void set_iside_error(uint32_t addr) override;
+  const std::vector<std::string> &get_errors() override;
+  void clear_errors() override;
+  unsigned int get_insn_cnt() override;
+  uint64_t free_run(uint64_t max_steps, bool stop_at_pc,
+                    uint32_t stop_pc) override;
+
+ private:
+  // A call of the checker
+  struct Record {
+    enum Op : uint8_t {
+      kStep,
+      kSetMip,
+      kSetNmi,
+      kSetNmiInt,
+      kSetDebugReq,
+      kSetMcycle,
+      kSetCsr,
+      kSetIcScrKeyValid,
+      kNotifyDsideAccess,
+      kSetIsideError,
+    };
+    Op op;
+    // Arguments, depending on op
+    bool flag_a;
+    bool flag_b;
+    uint32_t a;
+    uint32_t b;
+    uint32_t c;
+    uint64_t wide;
+    DSideAccessInfo access_info;
+  };
+
+  // Number of records in the ring buffer, a power of two. Lets the simulation
+  // run a few thousand instructions ahead of the co-simulator.
+  static const size_t kNumRecords = 1 << 16;
+
+  std::unique_ptr<Cosim> cosim_;
+  VerilatorSimCtrl &simctrl_;
+  std::vector<Record> records_;
+
+  // Records up to head_ have been pushed, records up to tail_ applied. Both
+  // count up without wrapping, on separate cache lines to not slow down each
+  // other.
+  alignas(64) std::atomic<uint64_t> head_;
+  alignas(64) std::atomic<uint64_t> tail_;
+
+  // State of the producer: the next record to push and the last tail_ seen.
+  // head_ is only published at each step, so the consumer wakes up once per
+  // instruction.
+  alignas(64) uint64_t push_head_;
+  uint64_t cached_tail_;
+
+  std::atomic<bool> stop_;
+  std::atomic<bool> failed_;
+  // First mismatch, written by the worker before failed_
+  uint64_t mismatch_cycle_;
+  uint32_t mismatch_pc_;
+  std::vector<std::string> mismatch_errors_;
+
+  std::thread worker_;
+
+  Record &Push(Record::Op op);
+  void Publish() { head_.store(push_head_, std::memory_order_release); }
+  void Work();
+  void Apply(const Record &record);
+};
+
+#endif  // ASYNC_COSIM_H_
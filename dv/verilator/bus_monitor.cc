@@ -0,0 +1,230 @@
+// Copyright lowRISC contributors.
+// Licensed under the Apache License, Version 2.0, see LICENSE for details.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "bus_monitor.h"
+
+#include <cstdlib>
+#include <fstream>
+#include <getopt.h>
+#include <iomanip>
+#include <iostream>
+#include <svdpi.h>
+
+// DPI export, defined in ibex_demo_system.sv
+extern "C" {
+extern void bus_monitor_set(svBit enable, void *monitor);
+}
+
+// DPI imports, called by ibex_demo_system.sv for each granted request and
+// each response of the bus
+extern "C" void bus_monitor_request(void *monitor, int host, int device,
+                                    svBit we, unsigned int addr,
+                                    unsigned int wait_cycles) {
+  static_cast<BusMonitor *>(monitor)->OnRequest(host, device, we, addr,
+                                                wait_cycles);
+}
+
+extern "C" void bus_monitor_response(void *monitor, int host,
+                                     unsigned int cycles) {
+  static_cast<BusMonitor *>(monitor)->OnResponse(host, cycles);
+}
+
+// Names in the order of bus_host_e and bus_device_e in ibex_demo_system.sv
+static const char *const kHostNames[] = {"CoreD", "DbgHost"};
+static const int kNumHosts = sizeof(kHostNames) / sizeof(kHostNames[0]);
+static const char *const kDeviceNames[] = {
+    "Ram", "Gpio", "Pwm", "Uart", "Timer", "Spi", "SimCtrl", "DbgDev"};
+static const int kNumDevices = sizeof(kDeviceNames) / sizeof(kDeviceNames[0]);
+
+static const char *const kWaitBucketNames[BusMonitor::kNumWaitBuckets] = {
+    "wait_0", "wait_1", "wait_2_3", "wait_4_7", "wait_8_15", "wait_16_plus"};
+
+std::string BusMonitor::HostName(int host) {
+  return host >= 0 && host < kNumHosts ? kHostNames[host] : std::to_string(host);
+}
+
+std::string BusMonitor::DeviceName(int device) {
+  return device >= 0 && device < kNumDevices ? kDeviceNames[device]
+                                             : "(unmapped)";
+}
+
+static int WaitBucket(uint32_t wait_cycles) {
+  int bucket = 0;
+  while (wait_cycles && bucket < BusMonitor::kNumWaitBuckets - 1) {
+    wait_cycles >>= 1;
+    ++bucket;
+  }
+  return bucket;
+}
+
+BusMonitor::BusMonitor(const std::string &scope)
+    : scope_(scope), block_bytes_(64), started_(false) {}
+
+bool BusMonitor::ParseCLIArguments(int argc, char **argv, bool &exit_app) {
+  const struct option long_options[] = {
+      {"bus-profile", required_argument, nullptr, 'B'},
+      {"bus-profile-block", required_argument, nullptr, 'K'},
+      {"help", no_argument, nullptr, 'h'},
+      {nullptr, no_argument, nullptr, 0}};
+
+  // Reset the command parsing index in-case other utils have already parsed
+  // some arguments
+  optind = 1;
+  while (1) {
+    int c = getopt_long(argc, argv, "-:h", long_options, nullptr);
+    if (c == -1) {
+      break;
+    }
+
+    // Disable error reporting by getopt
+    opterr = 0;
+
+    switch (c) {
+      case 'B':
+        out_prefix_ = optarg;
+        break;
+      case 'K': {
+        char *txt_end;
+        block_bytes_ = strtoul(optarg, &txt_end, 0);
+        if (*txt_end || !block_bytes_ ||
+            (block_bytes_ & (block_bytes_ - 1))) {
+          std::cerr << "ERROR: --bus-profile-block must be a power of two. "
+                       "Got: `"
+                    << optarg << "'." << std::endl;
+          return false;
+        }
+        break;
+      }
+      case 'h':
+        std::cout << "--bus-profile=PREFIX\n"
+                     "  Write the requests, grant waits and response cycles "
+                     "of each bus\n"
+                     "  device to PREFIX.csv and the accessed addresses to\n"
+                     "  PREFIX_heatmap.csv\n\n"
+                     "--bus-profile-block=BYTES\n"
+                     "  Size of the address blocks of the heat map, a power "
+                     "of two\n"
+                     "  (default: 64)\n\n";
+        return true;
+      case ':':  // missing argument
+        std::cerr << "ERROR: Missing argument." << std::endl << std::endl;
+        return false;
+      default:;
+        // Ignore unrecognized options since they might be consumed by
+        // other utils
+    }
+  }
+
+  return true;
+}
+
+void BusMonitor::OnClock(unsigned long sim_time) {
+  // Enable the reporting in the first cycle, after the initial blocks ran
+  if (out_prefix_.empty()) {
+    return;
+  }
+  svSetScope(svGetScopeFromName(scope_.c_str()));
+  bus_monitor_set(1, this);
+  started_ = true;
+}
+
+void BusMonitor::PostExec() {
+  if (started_) {
+    svSetScope(svGetScopeFromName(scope_.c_str()));
+    bus_monitor_set(0, nullptr);
+    WriteReport();
+  }
+
+  // Start over if the simulation runs again, e.g. in sim server mode
+  started_ = false;
+  traffic_.clear();
+  outstanding_.clear();
+  heatmap_.clear();
+}
+
+void BusMonitor::OnRequest(int host, int device, bool write, uint32_t addr,
+                           uint32_t wait_cycles) {
+  Traffic &traffic = traffic_[std::make_pair(device, host)];
+  if (write) {
+    ++traffic.writes;
+  } else {
+    ++traffic.reads;
+  }
+  traffic.wait_cycles += wait_cycles;
+  if (wait_cycles > traffic.max_wait_cycles) {
+    traffic.max_wait_cycles = wait_cycles;
+  }
+  ++traffic.wait_histogram[WaitBucket(wait_cycles)];
+  outstanding_[host] = device;
+
+  auto &block = heatmap_[std::make_pair(device, addr & ~(block_bytes_ - 1))];
+  if (write) {
+    ++block.second;
+  } else {
+    ++block.first;
+  }
+}
+
+void BusMonitor::OnResponse(int host, uint32_t cycles) {
+  auto it = outstanding_.find(host);
+  if (it == outstanding_.end()) {
+    return;
+  }
+  Traffic &traffic = traffic_[std::make_pair(it->second, host)];
+  ++traffic.responses;
+  traffic.response_cycles += cycles;
+  outstanding_.erase(it);
+}
+
+void BusMonitor::WriteReport() const {
+  std::cout << "\nBus Traffic" << std::endl
+            << "===========" << std::endl
+            << "Device      Host       Reads    Writes  Wait cycles  Max wait"
+            << std::endl;
+
+  std::string csv_path = out_prefix_ + ".csv";
+  std::ofstream csv(csv_path);
+  csv << "device,host,requests,reads,writes,wait_cycles,max_wait_cycles";
+  for (const char *bucket_name : kWaitBucketNames) {
+    csv << "," << bucket_name;
+  }
+  csv << ",responses,response_cycles\n";
+
+  for (const auto &pr : traffic_) {
+    const Traffic &traffic = pr.second;
+    std::string device = DeviceName(pr.first.first);
+    std::string host = HostName(pr.first.second);
+
+    std::cout << std::left << std::setw(12) << device << std::setw(8) << host
+              << std::right << std::setw(8) << traffic.reads << std::setw(10)
+              << traffic.writes << std::setw(13) << traffic.wait_cycles
+              << std::setw(10) << traffic.max_wait_cycles << std::endl;
+
+    csv << device << "," << host << "," << traffic.reads + traffic.writes
+        << "," << traffic.reads << "," << traffic.writes << ","
+        << traffic.wait_cycles << "," << traffic.max_wait_cycles;
+    for (unsigned long count : traffic.wait_histogram) {
+      csv << "," << count;
+    }
+    csv << "," << traffic.responses << "," << traffic.response_cycles << "\n";
+  }
+
+  std::string heatmap_path = out_prefix_ + "_heatmap.csv";
+  std::ofstream heatmap(heatmap_path);
+  heatmap << "device,address,reads,writes\n" << std::hex << std::setfill('0');
+  for (const auto &pr : heatmap_) {
+    heatmap << DeviceName(pr.first.first) << ",0x" << std::setw(8)
+            << pr.first.second << "," << std::dec << pr.second.first << ","
+            << pr.second.second << "\n"
+            << std::hex;
+  }
+
+  if (!csv || !heatmap) {
+    std::cerr << "ERROR: Could not write bus profile to `" << csv_path
+              << "' and `" << heatmap_path << "'." << std::endl;
+    return;
+  }
+  std::cout << "Bus profile written to " << csv_path << " and "
+            << heatmap_path << std::endl;
+}
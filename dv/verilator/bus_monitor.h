@@ -0,0 +1,103 @@
+// Copyright lowRISC contributors.
+// Licensed under the Apache License, Version 2.0, see LICENSE for details.
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef BUS_MONITOR_H_
+#define BUS_MONITOR_H_
+
+#include <array>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <utility>
+
+#include "sim_ctrl_extension.h"
+
+/**
+ * Traffic and contention profile of the data bus
+ *
+ * With --bus-profile=PREFIX, the design reports every request granted by the
+ * bus and every response, see bus_monitor_set() in ibex_demo_system.sv. At the
+ * end of the simulation, a summary is printed and two files are written:
+ *
+ * - PREFIX.csv: for each device and host, the number of requests, reads and
+ *   writes, the cycles spent waiting for the grant, as total, maximum and
+ *   histogram, and the cycles from grant to response.
+ * - PREFIX_heatmap.csv: the reads and writes of each block of addresses of
+ *   each device. The block size is set with --bus-profile-block.
+ *
+ * Instruction fetches don't go through the bus and aren't included.
+ */
+class BusMonitor : public SimCtrlExtension {
+ public:
+  // Buckets of the grant wait histogram: 0, 1, 2-3, 4-7, 8-15 and 16 or more
+  // cycles
+  static const int kNumWaitBuckets = 6;
+
+  /**
+   * @param scope DPI scope of the module exporting bus_monitor_set()
+   */
+  explicit BusMonitor(const std::string &scope);
+
+  // Declared in SimCtrlExtension
+  bool ParseCLIArguments(int argc, char **argv, bool &exit_app) override;
+  void OnClock(unsigned long sim_time) override;
+  unsigned long NextWakeupCycle(unsigned long cycle) override {
+    return kNoWakeup;
+  }
+  void PostExec() override;
+
+  /**
+   * Account for a granted request, called through the DPI
+   */
+  void OnRequest(int host, int device, bool write, uint32_t addr,
+                 uint32_t wait_cycles);
+
+  /**
+   * Account for a response, called through the DPI
+   */
+  void OnResponse(int host, uint32_t cycles);
+
+  /**
+   * Name of a host of the bus, in the order of bus_host_e in
+   * ibex_demo_system.sv
+   */
+  static std::string HostName(int host);
+
+  /**
+   * Name of a device of the bus, in the order of bus_device_e in
+   * ibex_demo_system.sv
+   *
+   * Requests not decoded to any device have the index of the device after the
+   * last one.
+   */
+  static std::string DeviceName(int device);
+
+ private:
+  struct Traffic {
+    unsigned long reads;
+    unsigned long writes;
+    unsigned long wait_cycles;
+    unsigned long max_wait_cycles;
+    std::array<unsigned long, kNumWaitBuckets> wait_histogram;
+    unsigned long responses;
+    unsigned long response_cycles;
+  };
+
+  std::string scope_;
+  std::string out_prefix_;
+  uint32_t block_bytes_;
+  bool started_;
+
+  // Traffic by device and host
+  std::map<std::pair<int, int>, Traffic> traffic_;
+  // Device of the outstanding request of each host
+  std::map<int, int> outstanding_;
+  // Reads and writes by device and address block
+  std::map<std::pair<int, uint32_t>, std::pair<unsigned long, unsigned long>>
+      heatmap_;
+
+  void WriteReport() const;
+};
+
+#endif  // BUS_MONITOR_H_
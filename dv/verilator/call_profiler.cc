@@ -0,0 +1,410 @@
+// Copyright lowRISC contributors.
+// Licensed under the Apache License, Version 2.0, see LICENSE for details.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "call_profiler.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <getopt.h>
+#include <iostream>
+#include <svdpi.h>
+
+// DPI exports, defined in ibex_demo_system.sv
+extern "C" {
+extern void call_profiler_set(svBit enable, void *profiler);
+extern unsigned long long mhpmcounter_get(int index);
+}
+
+// DPI import, called by ibex_demo_system.sv for each retired jump and trap
+extern "C" void call_profiler_event(
+    void *profiler, svBit trap, unsigned int pc, unsigned int insn,
+    unsigned int target, unsigned long long cycles, unsigned long long instret,
+    unsigned long long loads, unsigned long long stores,
+    unsigned long long branches_taken, unsigned long long mul_wait,
+    unsigned long long div_wait) {
+  static_cast<CallProfiler *>(profiler)->OnJump(
+      trap, pc, insn, target,
+      {cycles, instret, loads, stores, branches_taken, mul_wait, div_wait});
+}
+
+// mhpmcounter indices of the events, see mhpmcounter_get()
+static const int kEventCounters[CallProfiler::kNumEvents] = {0, 2,  5, 6,
+                                                             9, 11, 12};
+// Event names used in the CSV header
+static const char *const kEventNames[CallProfiler::kNumEvents] = {
+    "cycles", "instret", "loads", "stores", "branches_taken", "mul_wait",
+    "div_wait"};
+// Event names used in the callgrind file
+static const char *const kCallgrindEvents[CallProfiler::kNumEvents] = {
+    "Cycles", "Instructions", "Loads", "Stores", "BranchesTaken", "MulWait",
+    "DivWait"};
+
+static const uint32_t kInsnMret = 0x30200073;
+
+static bool IsLinkReg(uint32_t reg) { return reg == 1 || reg == 5; }
+
+CallProfiler::CallProfiler(const std::string &scope)
+    : scope_(scope),
+      out_prefix_("ibex_demo_system_call_profile"),
+      write_csv_(true),
+      write_callgrind_(true),
+      started_(false),
+      last_(),
+      now_() {}
+
+bool CallProfiler::ParseCLIArguments(int argc, char **argv, bool &exit_app) {
+  const struct option long_options[] = {
+      {"call-profile", required_argument, nullptr, 'P'},
+      {"call-profile-out", required_argument, nullptr, 'O'},
+      {"call-profile-format", required_argument, nullptr, 'F'},
+      {"help", no_argument, nullptr, 'h'},
+      {nullptr, no_argument, nullptr, 0}};
+
+  // Reset the command parsing index in-case other utils have already parsed
+  // some arguments
+  optind = 1;
+  while (1) {
+    int c = getopt_long(argc, argv, "-:h", long_options, nullptr);
+    if (c == -1) {
+      break;
+    }
+
+    // Disable error reporting by getopt
+    opterr = 0;
+
+    switch (c) {
+      case 'P':
+        elf_path_ = optarg;
+        break;
+      case 'O':
+        out_prefix_ = optarg;
+        break;
+      case 'F': {
+        std::string format(optarg);
+        write_csv_ = format == "csv" || format == "both";
+        write_callgrind_ = format == "callgrind" || format == "both";
+        if (!write_csv_ && !write_callgrind_) {
+          std::cerr << "ERROR: --call-profile-format must be one of 'csv', "
+                       "'callgrind' or 'both'. Got: `"
+                    << optarg << "'." << std::endl;
+          return false;
+        }
+        break;
+      }
+      case 'h':
+        std::cout << "--call-profile=ELF\n"
+                     "--call-profile-out=PREFIX\n"
+                     "--call-profile-format=csv|callgrind|both\n"
+                     "  Follow the calls of the software in ELF and write "
+                     "the cycles and\n"
+                     "  performance counter events of each function to "
+                     "PREFIX.csv and/or\n"
+                     "  PREFIX.callgrind (default PREFIX: "
+                     "ibex_demo_system_call_profile,\n"
+                     "  default format: both)\n\n";
+        return true;
+      case ':':  // missing argument
+        std::cerr << "ERROR: Missing argument." << std::endl << std::endl;
+        return false;
+      default:;
+        // Ignore unrecognized options since they might be consumed by
+        // other utils
+    }
+  }
+
+  if (!elf_path_.empty() && !symbols_.Load(elf_path_)) {
+    return false;
+  }
+
+  return true;
+}
+
+void CallProfiler::OnClock(unsigned long sim_time) {
+  // Enable the reporting in the first cycle, after the initial blocks ran
+  if (elf_path_.empty()) {
+    return;
+  }
+  svSetScope(svGetScopeFromName(scope_.c_str()));
+  call_profiler_set(1, this);
+  started_ = true;
+}
+
+void CallProfiler::PostExec() {
+  if (started_) {
+    // Account for the events since the last jump and unwind the stack
+    svSetScope(svGetScopeFromName(scope_.c_str()));
+    call_profiler_set(0, nullptr);
+    Costs counters;
+    for (int i = 0; i < kNumEvents; ++i) {
+      counters[i] = mhpmcounter_get(kEventCounters[i]);
+    }
+    Advance(counters);
+    while (!stack_.empty()) {
+      Pop();
+    }
+
+    if (write_csv_) {
+      WriteCsv(out_prefix_ + ".csv");
+    }
+    if (write_callgrind_) {
+      WriteCallgrind(out_prefix_ + ".callgrind");
+    }
+  }
+
+  // Start over if the simulation runs again, e.g. in sim server mode
+  started_ = false;
+  funcs_.clear();
+  func_idxs_.clear();
+  stack_.clear();
+  last_ = Costs();
+  now_ = Costs();
+}
+
+void CallProfiler::OnJump(bool trap, uint32_t pc, uint32_t insn,
+                          uint32_t target, const Costs &counters) {
+  // The events up to here belong to the function jumping
+  if (stack_.empty()) {
+    Push(FunctionIndex(pc), 0, false, false);
+  }
+  Advance(counters);
+
+  if (trap) {
+    Push(FunctionIndex(target), 0, true, true);
+    return;
+  }
+
+  if (insn == kInsnMret) {
+    // Unwind to the frame interrupted by the trap
+    auto it = std::find_if(stack_.rbegin(), stack_.rend(),
+                           [](const Frame &frame) { return frame.trap; });
+    if (it != stack_.rend()) {
+      size_t depth = stack_.rend() - it - 1;
+      while (stack_.size() > depth) {
+        Pop();
+      }
+    }
+    if (stack_.empty()) {
+      Push(FunctionIndex(target), 0, false, false);
+    }
+    return;
+  }
+
+  // Decode the jump
+  uint32_t rd, rs1, len;
+  bool is_jalr;
+  if ((insn & 3) == 3) {
+    rd = (insn >> 7) & 31;
+    rs1 = (insn >> 15) & 31;
+    is_jalr = (insn & 0x7f) == 0x67;
+    len = 4;
+  } else if ((insn & 3) == 1) {
+    // c.jal or c.j
+    rd = ((insn >> 13) & 7) == 1 ? 1 : 0;
+    rs1 = 0;
+    is_jalr = false;
+    len = 2;
+  } else {
+    // c.jalr or c.jr
+    rd = (insn >> 12) & 1;
+    rs1 = (insn >> 7) & 31;
+    is_jalr = true;
+    len = 2;
+  }
+
+  if (IsLinkReg(rd)) {
+    Push(FunctionIndex(target), pc + len, false, true);
+    return;
+  }
+
+  if (is_jalr && IsLinkReg(rs1)) {
+    // Return to the frame expecting target, not unwinding past a trap
+    for (size_t i = stack_.size(); i-- > 0;) {
+      if (stack_[i].ret_addr == target) {
+        while (stack_.size() > i) {
+          Pop();
+        }
+        break;
+      }
+      if (stack_[i].trap) {
+        break;
+      }
+    }
+    if (stack_.empty()) {
+      Push(FunctionIndex(target), 0, false, false);
+    }
+    return;
+  }
+
+  // A jump to the start of another function is a tail call
+  std::string name;
+  uint32_t start;
+  if (symbols_.FunctionAt(target, name, start) && start == target &&
+      funcs_[stack_.back().func].start != target) {
+    Frame frame = stack_.back();
+    Pop();
+    Push(FunctionIndex(target), frame.ret_addr, frame.trap, true);
+  }
+}
+
+bool CallProfiler::FoldedStack(std::string &folded) const {
+  if (!started_) {
+    return false;
+  }
+  for (const Frame &frame : stack_) {
+    if (!folded.empty()) {
+      folded += ';';
+    }
+    folded += funcs_[frame.func].name;
+  }
+  return true;
+}
+
+size_t CallProfiler::FunctionIndex(uint32_t addr) {
+  std::string name;
+  uint32_t start;
+  if (!symbols_.FunctionAt(addr, name, start)) {
+    char addr_str[16];
+    snprintf(addr_str, sizeof(addr_str), "0x%08x", addr);
+    name = addr_str;
+    start = addr;
+  }
+
+  auto it = func_idxs_.find(name);
+  if (it != func_idxs_.end()) {
+    return it->second;
+  }
+
+  funcs_.push_back({name, start, 0, Costs(), Costs(), 0, {}});
+  func_idxs_[name] = funcs_.size() - 1;
+  return funcs_.size() - 1;
+}
+
+void CallProfiler::Advance(const Costs &counters) {
+  Costs delta;
+  for (int i = 0; i < kNumEvents; ++i) {
+    // The software may have reset the counter since the last jump
+    delta[i] = counters[i] >= last_[i] ? counters[i] - last_[i] : counters[i];
+    now_[i] += delta[i];
+  }
+  last_ = counters;
+
+  if (!stack_.empty()) {
+    Costs &self = funcs_[stack_.back().func].self;
+    for (int i = 0; i < kNumEvents; ++i) {
+      self[i] += delta[i];
+    }
+  }
+}
+
+void CallProfiler::Push(size_t func, uint32_t ret_addr, bool trap,
+                        bool is_call) {
+  Function &function = funcs_[func];
+  if (is_call) {
+    ++function.calls;
+    if (!stack_.empty()) {
+      ++funcs_[stack_.back().func].callees[func].calls;
+    }
+  }
+  ++function.depth;
+  stack_.push_back({func, ret_addr, trap, now_});
+}
+
+void CallProfiler::Pop() {
+  const Frame frame = stack_.back();
+  stack_.pop_back();
+
+  Function &function = funcs_[frame.func];
+  --function.depth;
+  Call *call = nullptr;
+  if (!stack_.empty()) {
+    call = &funcs_[stack_.back().func].callees[frame.func];
+  }
+  for (int i = 0; i < kNumEvents; ++i) {
+    uint64_t delta = now_[i] - frame.entry[i];
+    // Recursive calls are already included in the outermost one
+    if (!function.depth) {
+      function.inclusive[i] += delta;
+    }
+    if (call) {
+      call->inclusive[i] += delta;
+    }
+  }
+}
+
+void CallProfiler::WriteCsv(const std::string &path) const {
+  std::vector<const Function *> sorted;
+  for (const Function &function : funcs_) {
+    sorted.push_back(&function);
+  }
+  std::sort(sorted.begin(), sorted.end(),
+            [](const Function *a, const Function *b) {
+              return a->self[kCycles] > b->self[kCycles] ||
+                     (a->self[kCycles] == b->self[kCycles] &&
+                      a->name < b->name);
+            });
+
+  std::ofstream csv(path);
+  csv << "function,calls";
+  for (int i = 0; i < kNumEvents; ++i) {
+    csv << "," << kEventNames[i] << "_self," << kEventNames[i]
+        << "_inclusive";
+  }
+  csv << "\n";
+  for (const Function *function : sorted) {
+    csv << function->name << "," << function->calls;
+    for (int i = 0; i < kNumEvents; ++i) {
+      csv << "," << function->self[i] << "," << function->inclusive[i];
+    }
+    csv << "\n";
+  }
+
+  if (!csv) {
+    std::cerr << "ERROR: Could not write call profile to `" << path << "'."
+              << std::endl;
+    return;
+  }
+  std::cout << "Call profile written to " << path << std::endl;
+}
+
+void CallProfiler::WriteCallgrind(const std::string &path) const {
+  std::ofstream out(path);
+  out << "# callgrind format\n"
+      << "version: 1\n"
+      << "creator: ibex_demo_system\n"
+      << "cmd: " << elf_path_ << "\n"
+      << "events:";
+  for (int i = 0; i < kNumEvents; ++i) {
+    out << " " << kCallgrindEvents[i];
+  }
+  out << "\nsummary:";
+  for (int i = 0; i < kNumEvents; ++i) {
+    out << " " << now_[i];
+  }
+  out << "\n";
+
+  // Without line information, all costs are at line 0
+  for (const Function &function : funcs_) {
+    out << "\nfn=" << function.name << "\n0";
+    for (int i = 0; i < kNumEvents; ++i) {
+      out << " " << function.self[i];
+    }
+    out << "\n";
+    for (const auto &pr : function.callees) {
+      out << "cfn=" << funcs_[pr.first].name << "\n"
+          << "calls=" << pr.second.calls << " 0\n0";
+      for (int i = 0; i < kNumEvents; ++i) {
+        out << " " << pr.second.inclusive[i];
+      }
+      out << "\n";
+    }
+  }
+
+  if (!out) {
+    std::cerr << "ERROR: Could not write call profile to `" << path << "'."
+              << std::endl;
+    return;
+  }
+  std::cout << "Call profile written to " << path << std::endl;
+}
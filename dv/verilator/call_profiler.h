@@ -0,0 +1,136 @@
+// Copyright lowRISC contributors.
+// Licensed under the Apache License, Version 2.0, see LICENSE for details.
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef CALL_PROFILER_H_
+#define CALL_PROFILER_H_
+
+#include <array>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "elf_symbols.h"
+#include "sim_ctrl_extension.h"
+
+/**
+ * Exact per-function profiler following the calls of the software
+ *
+ * With --call-profile=ELF, the design reports every retired jump and every
+ * trap, see call_profiler_set() in ibex_demo_system.sv. The profiler follows
+ * the calls and returns on a shadow call stack and attributes the performance
+ * counter events between two jumps to the function on top of the stack. Each
+ * function gets the events spent in its own code (self) and including the
+ * functions it called (inclusive).
+ *
+ * At the end of the simulation, the profile is written to PREFIX.csv, sorted
+ * by self cycles, and/or PREFIX.callgrind, which can be opened with
+ * KCachegrind. PREFIX is set with --call-profile-out and the formats with
+ * --call-profile-format.
+ *
+ * Calls are jumps which link to ra or t0, returns are jumps to a return
+ * address on the stack. Other jumps to the start of a function are tail calls,
+ * replacing the function on top of the stack. Traps push the handler onto the
+ * stack until mret.
+ */
+class CallProfiler : public SimCtrlExtension {
+ public:
+  // Counted events, in the order reported by the design
+  enum Event {
+    kCycles,
+    kInstret,
+    kLoads,
+    kStores,
+    kBranchesTaken,
+    kMulWait,
+    kDivWait,
+    kNumEvents
+  };
+  typedef std::array<uint64_t, kNumEvents> Costs;
+
+  /**
+   * @param scope DPI scope of the module exporting call_profiler_set()
+   */
+  explicit CallProfiler(const std::string &scope);
+
+  // Declared in SimCtrlExtension
+  bool ParseCLIArguments(int argc, char **argv, bool &exit_app) override;
+  void OnClock(unsigned long sim_time) override;
+  unsigned long NextWakeupCycle(unsigned long cycle) override {
+    return kNoWakeup;
+  }
+  void PostExec() override;
+
+  /**
+   * Account for a retired jump or a trap, called through the DPI
+   *
+   * @param trap True for a trap entry, \p insn is 0 then
+   * @param pc PC of the jump or of the instruction interrupted by the trap
+   * @param insn The jump instruction
+   * @param target PC of the next retired instruction
+   * @param counters Performance counters after the jump
+   */
+  void OnJump(bool trap, uint32_t pc, uint32_t insn, uint32_t target,
+              const Costs &counters);
+
+  /**
+   * Append the functions on the shadow call stack to \p folded, outermost
+   * first and separated by ';' like the folded stacks of flamegraph.pl
+   *
+   * @return false if the profiler isn't following the calls
+   */
+  bool FoldedStack(std::string &folded) const;
+
+ private:
+  struct Call {
+    unsigned long calls;
+    Costs inclusive;
+  };
+
+  struct Function {
+    std::string name;
+    uint32_t start;
+    unsigned long calls;
+    Costs self;
+    Costs inclusive;
+    // Number of frames of the function on the stack, for recursion
+    unsigned depth;
+    // Calls by callee index
+    std::map<size_t, Call> callees;
+  };
+
+  struct Frame {
+    size_t func;
+    // Address returned to, 0 for a trap handler or the first function
+    uint32_t ret_addr;
+    bool trap;
+    // now_ when the function was entered
+    Costs entry;
+  };
+
+  std::string scope_;
+  std::string elf_path_;
+  std::string out_prefix_;
+  bool write_csv_;
+  bool write_callgrind_;
+  ElfSymbols symbols_;
+  bool started_;
+
+  std::vector<Function> funcs_;
+  std::map<std::string, size_t> func_idxs_;
+  std::vector<Frame> stack_;
+  // Counter values at the last jump
+  Costs last_;
+  // Events counted since the start, robust to software writing the counters
+  Costs now_;
+
+  size_t FunctionIndex(uint32_t addr);
+  void Advance(const Costs &counters);
+  void Push(size_t func, uint32_t ret_addr, bool trap, bool is_call);
+  void Pop();
+  void WriteCsv(const std::string &path) const;
+  void WriteCallgrind(const std::string &path) const;
+};
+
+#endif  // CALL_PROFILER_H_
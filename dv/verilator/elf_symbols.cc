@@ -0,0 +1,108 @@
+// Copyright lowRISC contributors.
+// Licensed under the Apache License, Version 2.0, see LICENSE for details.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "elf_symbols.h"
+
+#include <fcntl.h>
+#include <iostream>
+#include <libelf.h>
+#include <unistd.h>
+
+// Is sym a label without type or size in an executable section, like the
+// entry points of the startup code?
+static bool IsCodeLabel(Elf *elf, const Elf32_Sym &sym) {
+  if (ELF32_ST_TYPE(sym.st_info) != STT_NOTYPE || sym.st_size != 0 ||
+      sym.st_shndx == SHN_UNDEF || sym.st_shndx >= SHN_LORESERVE) {
+    return false;
+  }
+  Elf_Scn *scn = elf_getscn(elf, sym.st_shndx);
+  const Elf32_Shdr *shdr = scn ? elf32_getshdr(scn) : nullptr;
+  return shdr && (shdr->sh_flags & SHF_EXECINSTR);
+}
+
+bool ElfSymbols::Load(const std::string &path) {
+  if (elf_version(EV_CURRENT) == EV_NONE) {
+    std::cerr << "ERROR: " << elf_errmsg(-1) << std::endl;
+    return false;
+  }
+
+  int fd = open(path.c_str(), O_RDONLY, 0);
+  if (fd < 0) {
+    std::cerr << "ERROR: Could not open ELF file `" << path << "'."
+              << std::endl;
+    return false;
+  }
+
+  Elf *elf = elf_begin(fd, ELF_C_READ, nullptr);
+  if (!elf || elf_kind(elf) != ELF_K_ELF) {
+    std::cerr << "ERROR: `" << path << "' is not an ELF file." << std::endl;
+    elf_end(elf);
+    close(fd);
+    return false;
+  }
+
+  // The simulated software is always a 32 bit ELF file
+  Elf_Scn *scn = nullptr;
+  while ((scn = elf_nextscn(elf, scn)) != nullptr) {
+    const Elf32_Shdr *shdr = elf32_getshdr(scn);
+    if (!shdr || shdr->sh_type != SHT_SYMTAB) {
+      continue;
+    }
+
+    Elf_Data *data = elf_getdata(scn, nullptr);
+    if (!data) {
+      continue;
+    }
+    const Elf32_Sym *syms = static_cast<const Elf32_Sym *>(data->d_buf);
+    size_t num_syms = data->d_size / sizeof(Elf32_Sym);
+    for (size_t i = 0; i < num_syms; ++i) {
+      int type = ELF32_ST_TYPE(syms[i].st_info);
+      if (type != STT_FUNC && type != STT_OBJECT && type != STT_NOTYPE) {
+        continue;
+      }
+      // Skip mapping symbols like $x, which only mark code or data
+      const char *name = elf_strptr(elf, shdr->sh_link, syms[i].st_name);
+      if (name && *name && *name != '$') {
+        addrs_.emplace(name, syms[i].st_value);
+        if (type == STT_FUNC || IsCodeLabel(elf, syms[i])) {
+          funcs_.emplace(syms[i].st_value, Function{name, syms[i].st_size});
+        }
+      }
+    }
+  }
+
+  elf_end(elf);
+  close(fd);
+  return true;
+}
+
+bool ElfSymbols::Lookup(const std::string &name, uint32_t &addr) const {
+  auto it = addrs_.find(name);
+  if (it == addrs_.end()) {
+    return false;
+  }
+  addr = it->second;
+  return true;
+}
+
+bool ElfSymbols::FunctionAt(uint32_t addr, std::string &name) const {
+  uint32_t start;
+  return FunctionAt(addr, name, start);
+}
+
+bool ElfSymbols::FunctionAt(uint32_t addr, std::string &name,
+                            uint32_t &start) const {
+  // Find the last function starting at or before addr
+  auto it = funcs_.upper_bound(addr);
+  if (it == funcs_.begin()) {
+    return false;
+  }
+  --it;
+  if (it->second.size && addr - it->first >= it->second.size) {
+    return false;
+  }
+  name = it->second.name;
+  start = it->first;
+  return true;
+}
@@ -0,0 +1,58 @@
+// Copyright lowRISC contributors.
+// Licensed under the Apache License, Version 2.0, see LICENSE for details.
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef ELF_SYMBOLS_H_
+#define ELF_SYMBOLS_H_
+
+#include <cstdint>
+#include <map>
+#include <string>
+
+/**
+ * Symbol table of an ELF file, e.g. the software running in the simulation
+ */
+class ElfSymbols {
+ public:
+  /**
+   * Read the function and object symbols of the ELF file at \p path
+   *
+   * @return false if the file can't be read, an error has been printed
+   */
+  bool Load(const std::string &path);
+
+  /**
+   * Get the address of the symbol \p name
+   *
+   * @return false if there is no such symbol
+   */
+  bool Lookup(const std::string &name, uint32_t &addr) const;
+
+  /**
+   * Get the name of the function containing the address \p addr
+   *
+   * Functions without a size (e.g. written in assembly) extend up to the next
+   * function.
+   *
+   * @return false if no function contains \p addr
+   */
+  bool FunctionAt(uint32_t addr, std::string &name) const;
+
+  /**
+   * Like FunctionAt() above, also getting the start address of the function
+   * in \p start
+   */
+  bool FunctionAt(uint32_t addr, std::string &name, uint32_t &start) const;
+
+ private:
+  struct Function {
+    std::string name;
+    uint32_t size;
+  };
+
+  std::map<std::string, uint32_t> addrs_;
+  // Functions by start address
+  std::map<uint32_t, Function> funcs_;
+};
+
+#endif  // ELF_SYMBOLS_H_
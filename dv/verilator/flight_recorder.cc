@@ -0,0 +1,258 @@
+// Copyright lowRISC contributors.
+// Licensed under the Apache License, Version 2.0, see LICENSE for details.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "flight_recorder.h"
+
+#include <cstdlib>
+#include <fstream>
+#include <getopt.h>
+#include <iomanip>
+#include <iostream>
+#include <svdpi.h>
+
+#include "bus_monitor.h"
+#include "verilator_sim_ctrl.h"
+
+// DPI export, defined in ibex_demo_system.sv
+extern "C" {
+extern svBit flight_recorder_set(svBit retire_enable, svBit bus_enable,
+                                 void *recorder);
+}
+
+// DPI imports, called by ibex_demo_system.sv for each retired instruction and
+// each response of the bus with the recorder given to flight_recorder_set()
+extern "C" void flight_recorder_retire(
+    void *recorder, unsigned long long time_val, unsigned int cycle,
+    unsigned int pc_rdata, unsigned int pc_wdata, unsigned int insn,
+    unsigned int rs1_addr, unsigned int rs1_rdata, unsigned int rs2_addr,
+    unsigned int rs2_rdata, unsigned int rs3_addr, unsigned int rs3_rdata,
+    unsigned int rd_addr, unsigned int rd_wdata, unsigned int mem_addr,
+    unsigned int mem_rmask, unsigned int mem_wmask, unsigned int mem_rdata,
+    unsigned int mem_wdata) {
+  RetiredInstr instr;
+  instr.time = time_val;
+  instr.cycle = cycle;
+  instr.pc_rdata = pc_rdata;
+  instr.pc_wdata = pc_wdata;
+  instr.insn = insn;
+  instr.rs1_addr = rs1_addr;
+  instr.rs1_rdata = rs1_rdata;
+  instr.rs2_addr = rs2_addr;
+  instr.rs2_rdata = rs2_rdata;
+  instr.rs3_addr = rs3_addr;
+  instr.rs3_rdata = rs3_rdata;
+  instr.rd_addr = rd_addr;
+  instr.rd_wdata = rd_wdata;
+  instr.mem_addr = mem_addr;
+  instr.mem_rmask = mem_rmask;
+  instr.mem_wmask = mem_wmask;
+  instr.mem_rdata = mem_rdata;
+  instr.mem_wdata = mem_wdata;
+  static_cast<FlightRecorder *>(recorder)->OnRetire(instr);
+}
+
+extern "C" void flight_recorder_bus(void *recorder, unsigned int req_cycle,
+                                    unsigned int resp_cycle, int host,
+                                    int device, svBit we, unsigned int be,
+                                    unsigned int addr, unsigned int data,
+                                    svBit err) {
+  FlightRecorder::BusTransaction transaction;
+  transaction.req_cycle = req_cycle;
+  transaction.resp_cycle = resp_cycle;
+  transaction.host = host;
+  transaction.device = device;
+  transaction.write = we;
+  transaction.err = err;
+  transaction.be = be;
+  transaction.addr = addr;
+  transaction.data = data;
+  static_cast<FlightRecorder *>(recorder)->OnBusTransaction(transaction);
+}
+
+FlightRecorder::FlightRecorder(VerilatorSimCtrl &simctrl,
+                               const std::string &scope)
+    : simctrl_(simctrl),
+      scope_(scope),
+      out_prefix_("ibex_demo_system_flight_recorder"),
+      requested_(false),
+      started_(false),
+      instrs_(256),
+      instrs_next_(0),
+      instrs_wrapped_(false),
+      bus_next_(0),
+      bus_wrapped_(false) {}
+
+static bool ParseRecordCount(const char *arg, const char *option,
+                             size_t &count) {
+  char *txt_end;
+  count = strtoul(arg, &txt_end, 0);
+  if (*arg == '\0' || *txt_end) {
+    std::cerr << "ERROR: " << option << " must be a number of records. Got: `"
+              << arg << "'." << std::endl;
+    return false;
+  }
+  return true;
+}
+
+bool FlightRecorder::ParseCLIArguments(int argc, char **argv,
+                                       bool &exit_app) {
+  const struct option long_options[] = {
+      {"flight-recorder", required_argument, nullptr, 'F'},
+      {"flight-recorder-bus", required_argument, nullptr, 'U'},
+      {"flight-recorder-out", required_argument, nullptr, 'O'},
+      {"help", no_argument, nullptr, 'h'},
+      {nullptr, no_argument, nullptr, 0}};
+
+  // Reset the command parsing index in-case other utils have already parsed
+  // some arguments
+  optind = 1;
+  while (1) {
+    int c = getopt_long(argc, argv, "-:h", long_options, nullptr);
+    if (c == -1) {
+      break;
+    }
+
+    // Disable error reporting by getopt
+    opterr = 0;
+
+    size_t count;
+    switch (c) {
+      case 'F':
+        if (!ParseRecordCount(optarg, "--flight-recorder", count)) {
+          return false;
+        }
+        instrs_.assign(count, RetiredInstr());
+        requested_ = true;
+        break;
+      case 'U':
+        if (!ParseRecordCount(optarg, "--flight-recorder-bus", count)) {
+          return false;
+        }
+        bus_.assign(count, BusTransaction());
+        requested_ = true;
+        break;
+      case 'O':
+        out_prefix_ = optarg;
+        break;
+      case 'h':
+        std::cout << "--flight-recorder=N\n"
+                     "  Keep the last N retired instructions and write them "
+                     "in the format of\n"
+                     "  ibex_tracer if the simulation fails or times out, 0 "
+                     "to disable\n"
+                     "  (default: 256)\n\n"
+                     "--flight-recorder-bus=N\n"
+                     "  Also keep the last N data bus transactions "
+                     "(default: 0)\n\n"
+                     "--flight-recorder-out=PREFIX\n"
+                     "  Write the instructions to PREFIX.log and the bus "
+                     "transactions to\n"
+                     "  PREFIX_bus.csv (default: "
+                     "ibex_demo_system_flight_recorder)\n\n";
+        return true;
+      case ':':  // missing argument
+        std::cerr << "ERROR: Missing argument." << std::endl << std::endl;
+        return false;
+      default:;
+        // Ignore unrecognized options since they might be consumed by
+        // other utils
+    }
+  }
+
+  return true;
+}
+
+void FlightRecorder::OnClock(unsigned long sim_time) {
+  // Enable the recording in the first cycle, after the initial blocks ran
+  if (instrs_.empty() && bus_.empty()) {
+    return;
+  }
+  svSetScope(svGetScopeFromName(scope_.c_str()));
+  if (!flight_recorder_set(!instrs_.empty(), !bus_.empty(), this)) {
+    // Built without RVFI, e.g. sim_fast. Only mention it if the recorder was
+    // asked for explicitly.
+    if (requested_) {
+      std::cout << "Flight recorder: not available, the simulation is built "
+                   "without RVFI."
+                << std::endl;
+    }
+    instrs_.clear();
+    bus_.clear();
+    return;
+  }
+  started_ = true;
+}
+
+void FlightRecorder::PostExec() {
+  if (started_ && SimulationFailed()) {
+    Dump();
+  }
+
+  // Start over if the simulation runs again, e.g. in sim server mode. The
+  // ring buffers keep their allocation.
+  if (started_) {
+    svSetScope(svGetScopeFromName(scope_.c_str()));
+    flight_recorder_set(0, 0, nullptr);
+  }
+  started_ = false;
+  instrs_next_ = 0;
+  instrs_wrapped_ = false;
+  bus_next_ = 0;
+  bus_wrapped_ = false;
+}
+
+bool FlightRecorder::SimulationFailed() const {
+  // The simulation controller ends a simulation at its timeout without
+  // marking it as failed
+  return !simctrl_.WasSimulationSuccessful() ||
+         (simctrl_.GetTimeout() &&
+          simctrl_.GetTime() / 2 >= simctrl_.GetTimeout());
+}
+
+void FlightRecorder::Dump() const {
+  std::string log_path = out_prefix_ + ".log";
+  size_t num_instrs = instrs_wrapped_ ? instrs_.size() : instrs_next_;
+  if (!instrs_.empty()) {
+    std::ofstream log(log_path);
+    log << kTraceHeader;
+    for (size_t i = 0; i < num_instrs; ++i) {
+      log << FormatTraceLine(
+          instrs_[(instrs_next_ + instrs_.size() - num_instrs + i) %
+                  instrs_.size()]);
+    }
+    if (!log) {
+      std::cerr << "ERROR: Could not write flight recorder to `" << log_path
+                << "'." << std::endl;
+      return;
+    }
+    std::cout << "Flight recorder: last " << num_instrs
+              << " retired instructions written to " << log_path << std::endl;
+  }
+
+  std::string bus_path = out_prefix_ + "_bus.csv";
+  size_t num_bus = bus_wrapped_ ? bus_.size() : bus_next_;
+  if (!bus_.empty()) {
+    std::ofstream csv(bus_path);
+    csv << "req_cycle,resp_cycle,host,device,access,be,address,data,err\n";
+    for (size_t i = 0; i < num_bus; ++i) {
+      const BusTransaction &transaction =
+          bus_[(bus_next_ + bus_.size() - num_bus + i) % bus_.size()];
+      csv << std::dec << transaction.req_cycle << ","
+          << transaction.resp_cycle << ","
+          << BusMonitor::HostName(transaction.host) << ","
+          << BusMonitor::DeviceName(transaction.device) << ","
+          << (transaction.write ? "write" : "read") << ",0x" << std::hex
+          << transaction.be << ",0x" << std::setfill('0') << std::setw(8)
+          << transaction.addr << ",0x" << std::setw(8) << transaction.data
+          << std::setfill(' ') << "," << transaction.err << "\n";
+    }
+    if (!csv) {
+      std::cerr << "ERROR: Could not write flight recorder to `" << bus_path
+                << "'." << std::endl;
+      return;
+    }
+    std::cout << "Flight recorder: last " << num_bus
+              << " bus transactions written to " << bus_path << std::endl;
+  }
+}
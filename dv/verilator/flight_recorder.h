@@ -0,0 +1,109 @@
+// Copyright lowRISC contributors.
+// Licensed under the Apache License, Version 2.0, see LICENSE for details.
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef FLIGHT_RECORDER_H_
+#define FLIGHT_RECORDER_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "sim_ctrl_extension.h"
+#include "trace_format.h"
+
+class VerilatorSimCtrl;
+
+/**
+ * Post-mortem record of the last retired instructions and bus transactions
+ *
+ * The design reports every retired instruction through RVFI, and with
+ * --flight-recorder-bus every data bus transaction, see flight_recorder_set()
+ * in ibex_demo_system.sv. They are kept in ring buffers allocated before the
+ * simulation starts, so recording costs a copy per instruction and nothing is
+ * written while the simulation passes. Designs built without RVFI record
+ * nothing.
+ *
+ * When the simulation fails (a stop was requested with a failure, e.g. by
+ * $error, $stop, a failed checkpoint or sim_fail() of the software) or hits
+ * its timeout, the records are written, oldest first:
+ *
+ * - PREFIX.log: the instructions in the format of ibex_tracer's trace.
+ * - PREFIX_bus.csv: the bus transactions, with the cycles of their request
+ *   and response.
+ */
+class FlightRecorder : public SimCtrlExtension {
+ public:
+  /**
+   * A data bus transaction, reported at its response
+   */
+  struct BusTransaction {
+    uint32_t req_cycle;
+    uint32_t resp_cycle;
+    int host;
+    int device;
+    bool write;
+    bool err;
+    uint32_t be;
+    uint32_t addr;
+    // Written data of writes, read data of reads
+    uint32_t data;
+  };
+
+  /**
+   * @param simctrl Simulation controller to get the result and timeout from
+   * @param scope DPI scope of the module exporting flight_recorder_set()
+   */
+  FlightRecorder(VerilatorSimCtrl &simctrl, const std::string &scope);
+
+  // Declared in SimCtrlExtension
+  bool ParseCLIArguments(int argc, char **argv, bool &exit_app) override;
+  void OnClock(unsigned long sim_time) override;
+  unsigned long NextWakeupCycle(unsigned long cycle) override {
+    return kNoWakeup;
+  }
+  void PostExec() override;
+
+  /**
+   * Record a retired instruction, called through the DPI
+   */
+  void OnRetire(const RetiredInstr &instr) {
+    instrs_[instrs_next_] = instr;
+    if (++instrs_next_ == instrs_.size()) {
+      instrs_next_ = 0;
+      instrs_wrapped_ = true;
+    }
+  }
+
+  /**
+   * Record a bus transaction, called through the DPI
+   */
+  void OnBusTransaction(const BusTransaction &transaction) {
+    bus_[bus_next_] = transaction;
+    if (++bus_next_ == bus_.size()) {
+      bus_next_ = 0;
+      bus_wrapped_ = true;
+    }
+  }
+
+ private:
+  VerilatorSimCtrl &simctrl_;
+  std::string scope_;
+  std::string out_prefix_;
+  // Whether the records were configured on the command line
+  bool requested_;
+  bool started_;
+
+  // Ring buffers, the next record overwrites the one at *_next_
+  std::vector<RetiredInstr> instrs_;
+  size_t instrs_next_;
+  bool instrs_wrapped_;
+  std::vector<BusTransaction> bus_;
+  size_t bus_next_;
+  bool bus_wrapped_;
+
+  bool SimulationFailed() const;
+  void Dump() const;
+};
+
+#endif  // FLIGHT_RECORDER_H_
@@ -3,8 +3,16 @@
 // SPDX-License-Identifier: Apache-2.0
 
 #include <cassert>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
 #include <fstream>
+#include <getopt.h>
 #include <iostream>
+#include <sstream>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
 
 #include "Vtop_verilator__Syms.h"
 #include "ibex_pcounts.h"
@@ -13,15 +21,92 @@
 #include "verilator_memutil.h"
 #include "verilator_sim_ctrl.h"
 
-DemoSystem::DemoSystem(const char *ram_hier_path, int ram_size_words)
-    : _ram(ram_hier_path, ram_size_words, 4) {}
+// DPI exports, defined in top_verilator.sv
+extern "C" {
+void top_verilator_reopen_handles();
+void top_verilator_start_job(const char *uart_log, const char *uart_input);
+}
+
+namespace {
+// An extension which does no work when called. Used to benchmark the cost of
+// calling extensions from the simulation controller.
+class BenchExtension : public SimCtrlExtension {
+ public:
+  explicit BenchExtension(unsigned long period) : period_(period) {}
+
+  void OnClock(unsigned long sim_time) override {}
+  unsigned long NextWakeupCycle(unsigned long cycle) override {
+    return cycle + period_;
+  }
+
+ private:
+  unsigned long period_;
+};
+
+bool WriteAll(int fd, const std::string &data) {
+  size_t written = 0;
+  while (written < data.size()) {
+    // Don't get killed by SIGPIPE if the client went away
+    ssize_t ret =
+        send(fd, data.data() + written, data.size() - written, MSG_NOSIGNAL);
+    if (ret < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+    written += ret;
+  }
+  return true;
+}
+
+// Read the next line (without the newline) from fd into line. buf keeps data
+// read beyond the line for the next call.
+bool ReadLine(int fd, std::string &buf, std::string &line) {
+  size_t newline_pos;
+  while ((newline_pos = buf.find('\n')) == std::string::npos) {
+    char chunk[256];
+    ssize_t ret = read(fd, chunk, sizeof(chunk));
+    if (ret <= 0) {
+      return false;
+    }
+    buf.append(chunk, ret);
+  }
+  line = buf.substr(0, newline_pos);
+  buf.erase(0, newline_pos + 1);
+  return true;
+}
+}  // namespace
+
+DemoSystem::DemoSystem(const char *ram_hier_path, int ram_size_words,
+                       VerilatorSimCtrl &simctrl)
+    : _simctrl(simctrl),
+      _top(simctrl.GetContext()),
+      _ram(ram_hier_path, ram_size_words, 4),
+      _sleep_fast_forward(simctrl, "TOP.top_verilator.u_ibex_demo_system",
+                          "TOP.top_verilator.u_ibex_demo_system.u_timer"),
+      _pc_trace_trigger(simctrl, "TOP.top_verilator.u_ibex_demo_system"),
+      _pc_sampler(simctrl, "TOP.top_verilator.u_ibex_demo_system",
+                  _call_profiler),
+      _call_profiler("TOP.top_verilator.u_ibex_demo_system"),
+      _stats_stream(simctrl, "TOP.top_verilator.u_ibex_demo_system"),
+      _pcount_series(simctrl, "TOP.top_verilator.u_ibex_demo_system"),
+      _perf_regions(simctrl, "TOP.top_verilator.u_ibex_demo_system"),
+      _bus_monitor("TOP.top_verilator.u_ibex_demo_system"),
+      _flight_recorder(simctrl, "TOP.top_verilator.u_ibex_demo_system"),
+      _pcount_csv_path("ibex_demo_system_pcount.csv"),
+      _bench_extensions_period(1) {}
 
 int DemoSystem::Main(int argc, char **argv) {
   bool exit_app;
   int ret_code = Setup(argc, argv, exit_app);
 
   if (exit_app) {
-    return ret_code;
+    return ret_code ? 0 : 1;
+  }
+
+  if (!_server_path.empty()) {
+    return Serve();
   }
 
   Run();
@@ -34,32 +119,117 @@ int DemoSystem::Main(int argc, char **argv) {
 }
 
 int DemoSystem::Setup(int argc, char **argv, bool &exit_app) {
-  VerilatorSimCtrl &simctrl = VerilatorSimCtrl::GetInstance();
-
-  simctrl.SetTop(&_top, &_top.clk_i, &_top.rst_ni,
-                 VerilatorSimCtrlFlags::ResetPolarityNegative);
+  _simctrl.SetTop(&_top, &_top.clk_i, &_top.rst_ni,
+                  VerilatorSimCtrlFlags::ResetPolarityNegative);
 
   _memutil.RegisterMemoryArea("ram", 0x0, &_ram);
-  simctrl.RegisterExtension(&_memutil);
+  _simctrl.RegisterExtension(&_memutil);
+  _simctrl.RegisterExtension(&_sleep_fast_forward);
+  _simctrl.RegisterExtension(&_pc_trace_trigger);
+  _simctrl.RegisterExtension(&_pc_sampler);
+  _simctrl.RegisterExtension(&_call_profiler);
+  _simctrl.RegisterExtension(&_stats_stream);
+  _simctrl.RegisterExtension(&_pcount_series);
+  _simctrl.RegisterExtension(&_perf_regions);
+  _simctrl.RegisterExtension(&_bus_monitor);
+  _simctrl.RegisterExtension(&_flight_recorder);
+  _simctrl.RegisterExtension(this);
 
   exit_app = false;
-  return simctrl.ParseCommandArgs(argc, argv, exit_app);
+  return _simctrl.ParseCommandArgs(argc, argv, exit_app);
+}
+
+bool DemoSystem::ParseCLIArguments(int argc, char **argv, bool &exit_app) {
+  const struct option long_options[] = {
+      {"bench-extensions", required_argument, nullptr, 'B'},
+      {"pcount-csv", required_argument, nullptr, 'P'},
+      {"server", required_argument, nullptr, 'S'},
+      {"help", no_argument, nullptr, 'h'},
+      {nullptr, no_argument, nullptr, 0}};
+
+  // Reset the command parsing index in-case other utils have already parsed
+  // some arguments
+  optind = 1;
+  while (1) {
+    int c = getopt_long(argc, argv, "-:h", long_options, nullptr);
+    if (c == -1) {
+      break;
+    }
+
+    // Disable error reporting by getopt
+    opterr = 0;
+
+    switch (c) {
+      case 'B': {
+        // --bench-extensions=N[,PERIOD]
+        char *txt_end;
+        unsigned long num = strtoul(optarg, &txt_end, 0);
+        if (*txt_end == ',') {
+          _bench_extensions_period = strtoul(txt_end + 1, &txt_end, 0);
+        }
+        if (*txt_end || !_bench_extensions_period) {
+          std::cerr << "ERROR: --bench-extensions must be of the form "
+                       "N[,PERIOD]. Got: `"
+                    << optarg << "'." << std::endl;
+          return false;
+        }
+        _bench_extensions.resize(num);
+        break;
+      }
+      case 'P':
+        _pcount_csv_path = optarg;
+        break;
+      case 'S':
+        _server_path = optarg;
+        break;
+      case 'h':
+        std::cout << "Ibex Demo System:\n\n"
+                     "--bench-extensions=N[,PERIOD]\n"
+                     "  Register N extensions which do nothing every PERIOD "
+                     "cycles,\n"
+                     "  to measure the overhead of calling extensions\n\n"
+                     "--pcount-csv=FILE\n"
+                     "  Write the performance counters to FILE instead of\n"
+                     "  ibex_demo_system_pcount.csv\n\n"
+                     "--server=SOCKET\n"
+                     "  Run simulation jobs received on the UNIX socket "
+                     "SOCKET, see\n"
+                     "  util/sim_client.py\n\n";
+        return true;
+      case ':':  // missing argument
+        std::cerr << "ERROR: Missing argument." << std::endl << std::endl;
+        return false;
+      default:;
+        // Ignore unrecognized options since they might be consumed by
+        // other utils
+    }
+  }
+
+  return true;
 }
 
 void DemoSystem::Run() {
-  VerilatorSimCtrl &simctrl = VerilatorSimCtrl::GetInstance();
+  // Extensions can't be registered while the simulation controller parses
+  // arguments, so register the benchmark extensions now.
+  for (auto &ext : _bench_extensions) {
+    ext.reset(new BenchExtension(_bench_extensions_period));
+    _simctrl.RegisterExtension(ext.get());
+  }
 
   std::cout << "Simulation of Ibex Demo System" << std::endl
             << "==============================" << std::endl
             << std::endl;
 
-  simctrl.RunSimulation();
+  _simctrl.RunSimulation();
 }
 
-bool DemoSystem::Finish() {
-  VerilatorSimCtrl &simctrl = VerilatorSimCtrl::GetInstance();
+void DemoSystem::RestoreCheckpoint(VerilatedDeserialize &is) {
+  svSetScope(svGetScopeFromName("TOP.top_verilator"));
+  top_verilator_reopen_handles();
+}
 
-  if (!simctrl.WasSimulationSuccessful()) {
+bool DemoSystem::Finish() {
+  if (!_simctrl.WasSimulationSuccessful()) {
     return false;
   }
 
@@ -72,8 +242,142 @@ bool DemoSystem::Finish() {
             << "====================" << std::endl;
   std::cout << ibex_pcount_string(false);
 
-  std::ofstream pcount_csv("ibex_demo_system_pcount.csv");
+  std::ofstream pcount_csv(_pcount_csv_path);
   pcount_csv << ibex_pcount_string(true);
 
   return true;
 }
+
+int DemoSystem::Serve() {
+  sockaddr_un addr = {};
+  addr.sun_family = AF_UNIX;
+  if (_server_path.size() >= sizeof(addr.sun_path)) {
+    std::cerr << "ERROR: Socket path `" << _server_path << "' is too long."
+              << std::endl;
+    return 1;
+  }
+  strcpy(addr.sun_path, _server_path.c_str());
+
+  int server_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  unlink(_server_path.c_str());
+  if (server_fd < 0 ||
+      bind(server_fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) ||
+      listen(server_fd, 1)) {
+    std::cerr << "ERROR: Unable to listen on `" << _server_path
+              << "': " << strerror(errno) << std::endl;
+    if (server_fd >= 0) {
+      close(server_fd);
+    }
+    return 1;
+  }
+
+  // Evaluate the initial blocks, which open the files each job reopens
+  _top.eval();
+
+  std::cout << "Simulation server listening on " << _server_path << std::endl;
+
+  bool quit = false;
+  while (!quit && !VerilatorSimCtrl::Interrupted()) {
+    int conn_fd = accept(server_fd, nullptr, nullptr);
+    if (conn_fd < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      std::cerr << "ERROR: accept() failed: " << strerror(errno) << std::endl;
+      break;
+    }
+
+    std::string buf;
+    std::string request;
+    while (!VerilatorSimCtrl::Interrupted() &&
+           ReadLine(conn_fd, buf, request)) {
+      if (request == "quit") {
+        quit = true;
+        break;
+      }
+      if (!WriteAll(conn_fd, RunJob(request))) {
+        break;
+      }
+    }
+    close(conn_fd);
+  }
+
+  close(server_fd);
+  unlink(_server_path.c_str());
+  return 0;
+}
+
+std::string DemoSystem::RunJob(const std::string &request) {
+  // elf=PATH [cycles=N] [uart_input=PATH]
+  std::string elf;
+  std::string uart_input;
+  unsigned long cycles = _simctrl.GetTimeout();
+
+  std::istringstream params(request);
+  std::string param;
+  while (params >> param) {
+    size_t eq_pos = param.find('=');
+    std::string key = param.substr(0, eq_pos);
+    std::string value =
+        eq_pos == std::string::npos ? "" : param.substr(eq_pos + 1);
+    if (key == "elf") {
+      elf = value;
+    } else if (key == "uart_input") {
+      uart_input = value;
+    } else if (key == "cycles") {
+      char *txt_end;
+      cycles = strtoul(value.c_str(), &txt_end, 0);
+      if (value.empty() || *txt_end) {
+        return "error Bad cycle limit `" + value + "'\n";
+      }
+    } else {
+      return "error Unknown job parameter `" + key + "'\n";
+    }
+  }
+  if (elf.empty()) {
+    return "error No elf given\n";
+  }
+  if (!uart_input.empty() && access(uart_input.c_str(), R_OK) != 0) {
+    return "error Cannot read UART input `" + uart_input + "'\n";
+  }
+
+  _simctrl.RewindSimulation();
+  _simctrl.SetTimeout(cycles);
+
+  // Stop the core of the last job from running while the RAM is reloaded
+  _top.rst_ni = 0;
+  _top.eval();
+
+  // Clear the RAM first, so that memory not covered by the ELF file doesn't
+  // keep the contents of the last job
+  _ram.Write(0, std::vector<uint8_t>(_ram.GetSizeBytes()));
+  try {
+    _memutil.GetUnderlying()->LoadFileToNamedMem(false, "ram", elf,
+                                                 kMemImageUnknown);
+  } catch (const std::exception &err) {
+    return std::string("error ") + err.what() + "\n";
+  }
+
+  std::string uart_log = _server_path + ".uart.log";
+  svSetScope(svGetScopeFromName("TOP.top_verilator"));
+  top_verilator_start_job(uart_log.c_str(), uart_input.c_str());
+
+  _simctrl.RunSimulation();
+
+  svSetScope(svGetScopeFromName("TOP.top_verilator.u_ibex_demo_system"));
+  std::string pcounts = ibex_pcount_string(true);
+
+  // Written by the UART until the end of the simulation closed it
+  std::ifstream uart_log_file(uart_log);
+  std::stringstream uart;
+  uart << uart_log_file.rdbuf();
+
+  std::ostringstream response;
+  response << "status " << (_simctrl.WasSimulationSuccessful() ? 0 : 1)
+           << "\n"
+           << "cycles " << _simctrl.GetTime() / 2 << "\n"
+           << "uart " << uart.str().size() << "\n"
+           << uart.str() << "pcount " << pcounts.size() << "\n"
+           << pcounts;
+  return response.str();
+}
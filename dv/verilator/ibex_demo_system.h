@@ -2,22 +2,75 @@
 // Licensed under the Apache License, Version 2.0, see LICENSE for details.
 // SPDX-License-Identifier: Apache-2.0
 
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "bus_monitor.h"
+#include "call_profiler.h"
+#include "flight_recorder.h"
+#include "pc_sampler.h"
+#include "pc_trace_trigger.h"
+#include "pcount_series.h"
+#include "perf_regions.h"
+#include "sim_ctrl_extension.h"
+#include "sleep_fast_forward.h"
+#include "stats_stream.h"
 #include "verilated_toplevel.h"
 #include "verilator_memutil.h"
+#include "verilator_sim_ctrl.h"
 
-class DemoSystem {
+class DemoSystem : public SimCtrlExtension {
  public:
-  DemoSystem(const char *ram_hier_path, int ram_size_words);
+  DemoSystem(const char *ram_hier_path, int ram_size_words,
+             VerilatorSimCtrl &simctrl = VerilatorSimCtrl::GetInstance());
   virtual ~DemoSystem() {}
   virtual int Main(int argc, char **argv);
 
+  // Declared in SimCtrlExtension
+  bool ParseCLIArguments(int argc, char **argv, bool &exit_app) override;
+  unsigned long NextWakeupCycle(unsigned long cycle) override {
+    return kNoWakeup;
+  }
+  void RestoreCheckpoint(VerilatedDeserialize &is) override;
 
  protected:
+  VerilatorSimCtrl &_simctrl;
   top_verilator _top;
   VerilatorMemUtil _memutil;
   MemArea _ram;
+  SleepFastForward _sleep_fast_forward;
+  PcTraceTrigger _pc_trace_trigger;
+  PcSampler _pc_sampler;
+  CallProfiler _call_profiler;
+  StatsStream _stats_stream;
+  PcountSeries _pcount_series;
+  PerfRegions _perf_regions;
+  BusMonitor _bus_monitor;
+  FlightRecorder _flight_recorder;
+  std::string _pcount_csv_path;
+  // UNIX socket to accept sim server jobs on, see --server
+  std::string _server_path;
+
+  // Extensions which only measure the simulation controller's overhead of
+  // calling into extensions, see --bench-extensions
+  unsigned long _bench_extensions_period;
+  std::vector<std::unique_ptr<SimCtrlExtension>> _bench_extensions;
 
   virtual int Setup(int argc, char **argv, bool &exit_app);
   virtual void Run();
   virtual bool Finish();
+
+  /**
+   * Run jobs received on the UNIX socket _server_path until a client sends
+   * "quit" or the process is interrupted
+   */
+  virtual int Serve();
+
+  /**
+   * Run the job described by a request line of the sim server
+   *
+   * @return The response to send to the client
+   */
+  std::string RunJob(const std::string &request);
 };
@@ -0,0 +1,724 @@
+// Copyright lowRISC contributors.
+// Licensed under the Apache License, Version 2.0, see LICENSE for details.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "ibex_demo_system_cosim.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+#include <getopt.h>
+#include <iostream>
+#include <svdpi.h>
+
+#include "verilated.h"
+#include "verilated_syms.h"
+
+#include "async_cosim.h"
+#include "elf_symbols.h"
+#include "spike_cosim.h"
+#include "verilator_sim_ctrl.h"
+
+// DPI exports, defined in ibex_demo_system_cosim_checker.sv
+extern "C" {
+extern void cosim_window_arm(svBit enable_check, int kind,
+                             unsigned long long value);
+extern unsigned int cosim_gpr_get(int index);
+extern unsigned int cosim_csr_get(int csr);
+extern void cosim_fast_forward_set_gpr(int index, unsigned int value);
+extern void cosim_fast_forward_set_csr(int csr, unsigned int value);
+}
+
+// Boundaries of cosim_window_arm()
+enum WindowKind {
+  kWindowNone = 0,
+  kWindowNext = 1,
+  kWindowInsns = 2,
+  kWindowPc = 3,
+};
+
+// Memory map of ibex_demo_system.sv
+static const uint32_t kRamBase = 0x00100000;
+static const uint32_t kResetVector = kRamBase + 0x80;
+static const struct {
+  uint32_t base;
+  size_t size;
+} kMmioRegions[] = {
+    {0x80000000, 4 * 1024},  // GPIO
+    {0x80001000, 4 * 1024},  // UART
+    {0x80002000, 4 * 1024},  // Timer
+    {0x80003000, 4 * 1024},  // PWM
+    {0x80004000, 1 * 1024},  // SPI
+    {0x00020000, 1 * 1024},  // Simulator control
+};
+
+// CSRs Spike takes from the core at the start of a window, in addition to the
+// ones the checker sets at every step
+static const int kSyncCsrs[] = {
+    CSR_MSTATUS, CSR_MIE,    CSR_MSCRATCH, CSR_MTVEC,
+    CSR_MEPC,    CSR_MCAUSE, CSR_MTVAL,    CSR_MCOUNTINHIBIT,
+};
+
+// CSRs handed to the core after a fast-forward. The counters restart in the
+// core, and mcountinhibit can't be written into it.
+static const int kHandoffCsrs[] = {
+    CSR_MSTATUS, CSR_MIE,    CSR_MSCRATCH, CSR_MTVEC,
+    CSR_MEPC,    CSR_MCAUSE, CSR_MTVAL,
+};
+
+// Cycles between checks whether a cycle boundary is the next boundary, when an
+// instruction or symbol boundary comes before it
+static const unsigned long kCyclePollPeriod = 64;
+
+// Cycles between checks for a mismatch found by the worker with --cosim-async
+static const unsigned long kAsyncPollPeriod = 1024;
+
+// Instructions Spike runs at most to reach a PC boundary of --fast-forward,
+// when the simulation has no cycle timeout to use instead
+static const uint64_t kFastForwardMaxInsns = 1000000000;
+
+// Encode `jal x0, offset`
+static uint32_t EncodeJump(int32_t offset) {
+  uint32_t imm = static_cast<uint32_t>(offset);
+  return (((imm >> 20) & 0x1) << 31) | (((imm >> 1) & 0x3ff) << 21) |
+         (((imm >> 11) & 0x1) << 20) | (((imm >> 12) & 0xff) << 12) | 0x6f;
+}
+
+// Key of the DemoSystemCosim in the user data of the checker's scope
+static int system_user_data_key;
+
+// System of the checker calling a DPI import
+static DemoSystemCosim *CallingSystem() {
+  auto system = static_cast<DemoSystemCosim *>(
+      svGetUserData(svGetScope(), &system_user_data_key));
+  assert(system);
+  return system;
+}
+
+// DPI imports, called by ibex_demo_system_cosim_checker.sv
+extern "C" {
+void *get_spike_cosim() {
+  DemoSystemCosim *system = CallingSystem();
+  assert(system->GetCosim());
+
+  return system->GetCosim();
+}
+
+void create_cosim(svBit secure_ibex, svBit icache_en,
+                  const svBitVecVal *pmp_num_regions,
+                  const svBitVecVal *pmp_granularity,
+                  const svBitVecVal *mhpm_counter_num) {
+  CallingSystem()->CreateCosim(secure_ibex, icache_en, pmp_num_regions[0],
+                               pmp_granularity[0], mhpm_counter_num[0]);
+}
+
+void cosim_window_boundary(unsigned int next_pc) {
+  CallingSystem()->OnWindowBoundary(next_pc);
+}
+}
+
+DemoSystemCosim::DemoSystemCosim(const char *ram_hier_path,
+                                 int ram_size_words,
+                                 VerilatorSimCtrl &simctrl)
+    : DemoSystem(ram_hier_path, ram_size_words, simctrl),
+      _checker_scope(
+          "TOP.top_verilator.u_ibex_demo_system."
+          "u_ibex_demo_system_cosim_checker_bind"),
+      _ram_scope(ram_hier_path),
+      _windowed(false),
+      _window(0),
+      _in_window(true),
+      _cycle_reached(false),
+      _windows_entered(0),
+      _async(false),
+      _async_cosim(nullptr),
+      _mismatch_reported(false),
+      _shared_ram(false),
+      _fast_forward(),
+      _fast_forwarded(false),
+      _handoff_pending(false),
+      _reset_vector_insn(0),
+      _measure_cycles(0),
+      _measure_end_cycle(0) {
+  // The checker's DPI imports find this system through its scope
+  svPutUserData(svGetScopeFromName(_checker_scope.c_str()),
+                &system_user_data_key, this);
+}
+
+void DemoSystemCosim::CreateCosim(bool secure_ibex, bool icache_en,
+                                  uint32_t pmp_num_regions,
+                                  uint32_t pmp_granularity,
+                                  uint32_t mhpm_counter_num) {
+  // The core of ibex_demo_system.sv is configured with RV32MFast and without
+  // the B extension
+  _cosim = std::make_unique<SpikeCosim>(
+      "rv32imc", kResetVector, kRamBase | 0x1, "ibex_demo_system_cosim.log",
+      secure_ibex, icache_en, pmp_num_regions, pmp_granularity,
+      mhpm_counter_num);
+
+  uint8_t *ram_data = nullptr;
+  if (_shared_ram) {
+    ram_data = GetSharedRamData();
+    if (!ram_data) {
+      std::cerr << "WARNING: Can't share the RAM `" << _ram_scope
+                << "' with Spike, copying it instead." << std::endl;
+      _shared_ram = false;
+    }
+  }
+
+  for (const auto &region : kMmioRegions) {
+    _cosim->add_mmio_region(region.base, region.size);
+  }
+  if (_shared_ram) {
+    _cosim->add_shared_memory(kRamBase, _ram.GetSizeBytes(), ram_data);
+  } else {
+    _cosim->add_memory(kRamBase, _ram.GetSizeBytes());
+    CopyMemAreaToCosim(&_ram, kRamBase);
+  }
+
+  if (_async) {
+    auto async_cosim =
+        std::make_unique<AsyncCosim>(std::move(_cosim), _simctrl);
+    _async_cosim = async_cosim.get();
+    _cosim = std::move(async_cosim);
+  }
+}
+
+void DemoSystemCosim::CopyMemAreaToCosim(MemArea *area, uint32_t base_addr) {
+  auto mem_data = area->Read(0, area->GetSizeWords());
+  _cosim->backdoor_write_mem(base_addr, area->GetSizeBytes(), &mem_data[0]);
+}
+
+uint8_t *DemoSystemCosim::GetSharedRamData() {
+  // The words of the array are stored in host byte order, the memory is
+  // little endian
+  if (__BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__) {
+    return nullptr;
+  }
+
+  // An svScope is a VerilatedScope. The array is only found if it is public,
+  // see ibex_demo_system_cosim.vlt.
+  auto scope = static_cast<const VerilatedScope *>(
+      svGetScopeFromName(_ram_scope.c_str()));
+  VerilatedVar *mem = scope ? scope->varFind("mem") : nullptr;
+  if (!mem || mem->entSize() != 4 ||
+      mem->totalSize() != _ram.GetSizeBytes()) {
+    return nullptr;
+  }
+  return static_cast<uint8_t *>(mem->datap());
+}
+
+bool DemoSystemCosim::ParseBoundary(const std::string &text,
+                                    Boundary &boundary) {
+  boundary.kind = Boundary::kNone;
+  boundary.value = 0;
+  boundary.symbol.clear();
+  if (text.empty()) {
+    return true;
+  }
+
+  size_t colon_pos = text.find(':');
+  if (colon_pos == std::string::npos) {
+    return false;
+  }
+  std::string kind = text.substr(0, colon_pos);
+  std::string value = text.substr(colon_pos + 1);
+  if (value.empty()) {
+    return false;
+  }
+
+  if (kind == "symbol") {
+    boundary.kind = Boundary::kPc;
+    boundary.symbol = value;
+    return true;
+  }
+
+  if (kind == "cycle") {
+    boundary.kind = Boundary::kCycle;
+  } else if (kind == "insn") {
+    boundary.kind = Boundary::kInsns;
+  } else if (kind == "pc") {
+    boundary.kind = Boundary::kPc;
+  } else {
+    return false;
+  }
+
+  char *txt_end;
+  boundary.value = strtoull(value.c_str(), &txt_end, 0);
+  return !*txt_end;
+}
+
+bool DemoSystemCosim::ResolveSymbols() {
+  std::vector<Boundary *> boundaries = {&_fast_forward};
+  for (auto &window : _windows) {
+    boundaries.push_back(&window.begin);
+    boundaries.push_back(&window.end);
+  }
+
+  ElfSymbols symbols;
+  bool loaded = false;
+  for (Boundary *boundary : boundaries) {
+    if (boundary->symbol.empty()) {
+      continue;
+    }
+    if (_elf_path.empty()) {
+      std::cerr << "ERROR: The symbol `" << boundary->symbol
+                << "' needs --cosim-elf." << std::endl;
+      return false;
+    }
+    if (!loaded && !symbols.Load(_elf_path)) {
+      return false;
+    }
+    loaded = true;
+
+    uint32_t addr;
+    if (!symbols.Lookup(boundary->symbol, addr)) {
+      std::cerr << "ERROR: No symbol `" << boundary->symbol << "' in `"
+                << _elf_path << "'." << std::endl;
+      return false;
+    }
+    boundary->value = addr;
+  }
+  return true;
+}
+
+bool DemoSystemCosim::ParseCLIArguments(int argc, char **argv,
+                                        bool &exit_app) {
+  if (!DemoSystem::ParseCLIArguments(argc, argv, exit_app)) {
+    return false;
+  }
+
+  const struct option long_options[] = {
+      {"cosim-window", required_argument, nullptr, 'W'},
+      {"cosim-elf", required_argument, nullptr, 'E'},
+      {"cosim-async", no_argument, nullptr, 'A'},
+      {"cosim-shared-ram", no_argument, nullptr, 'S'},
+      {"fast-forward", required_argument, nullptr, 'F'},
+      {"fast-forward-measure", required_argument, nullptr, 'M'},
+      {"help", no_argument, nullptr, 'h'},
+      {nullptr, no_argument, nullptr, 0}};
+
+  // Reset the command parsing index in-case other utils have already parsed
+  // some arguments
+  optind = 1;
+  while (1) {
+    int c = getopt_long(argc, argv, "-:h", long_options, nullptr);
+    if (c == -1) {
+      break;
+    }
+
+    // Disable error reporting by getopt
+    opterr = 0;
+
+    switch (c) {
+      case 'W': {
+        // --cosim-window=BEGIN,END
+        std::string arg(optarg);
+        size_t comma_pos = arg.find(',');
+        Window window;
+        if (comma_pos == std::string::npos ||
+            !ParseBoundary(arg.substr(0, comma_pos), window.begin) ||
+            !ParseBoundary(arg.substr(comma_pos + 1), window.end)) {
+          std::cerr << "ERROR: --cosim-window must be of the form BEGIN,END "
+                       "with boundaries\n"
+                       "cycle:N, insn:N, pc:ADDR or symbol:NAME. Got: `"
+                    << optarg << "'." << std::endl;
+          return false;
+        }
+        _windows.push_back(window);
+        break;
+      }
+      case 'E':
+        _elf_path = optarg;
+        break;
+      case 'A':
+        _async = true;
+        break;
+      case 'S':
+        _shared_ram = true;
+        break;
+      case 'F':
+        if (!ParseBoundary(optarg, _fast_forward) ||
+            _fast_forward.kind == Boundary::kNone ||
+            _fast_forward.kind == Boundary::kCycle) {
+          std::cerr << "ERROR: --fast-forward must be insn:N, pc:ADDR or "
+                       "symbol:NAME. Got: `"
+                    << optarg << "'." << std::endl;
+          return false;
+        }
+        break;
+      case 'M': {
+        char *txt_end;
+        _measure_cycles = strtoul(optarg, &txt_end, 0);
+        if (*txt_end || !_measure_cycles) {
+          std::cerr << "ERROR: --fast-forward-measure must be a number of "
+                       "cycles. Got: `"
+                    << optarg << "'." << std::endl;
+          return false;
+        }
+        break;
+      }
+      case 'h':
+        std::cout << "--cosim-window=BEGIN,END\n"
+                     "  Only check the core against Spike between the "
+                     "boundaries BEGIN and END,\n"
+                     "  given as cycle:N, insn:N (after N retired "
+                     "instructions), pc:ADDR or\n"
+                     "  symbol:NAME (before the instruction at ADDR or "
+                     "NAME). BEGIN may be\n"
+                     "  empty in the first and END in the last window. "
+                     "Repeat for several\n"
+                     "  windows, in the order the simulation reaches them "
+                     "(default: check\n"
+                     "  the whole simulation)\n\n"
+                     "--cosim-elf=ELF\n"
+                     "  Look up the symbols of --cosim-window in ELF\n\n"
+                     "--cosim-async\n"
+                     "  Step Spike on a worker thread, in parallel with the "
+                     "simulation. A\n"
+                     "  mismatch stops the simulation up to a few thousand "
+                     "cycles later.\n\n"
+                     "--cosim-shared-ram\n"
+                     "  Back the memory of Spike with the RAM of the "
+                     "simulation instead of a\n"
+                     "  copy of it, not with --cosim-async\n\n"
+                     "--fast-forward=BOUNDARY\n"
+                     "  Run the software in Spike up to BOUNDARY, given as "
+                     "insn:N, pc:ADDR or\n"
+                     "  symbol:NAME, then hand its state to the core and "
+                     "simulate from there\n\n"
+                     "--fast-forward-measure=CYCLES\n"
+                     "  End the simulation successfully CYCLES cycles after "
+                     "the handoff, the\n"
+                     "  performance counters then cover only these "
+                     "cycles\n\n";
+        return true;
+      case ':':  // missing argument
+        std::cerr << "ERROR: Missing argument." << std::endl << std::endl;
+        return false;
+      default:;
+        // Ignore unrecognized options since they might be consumed by
+        // other utils
+    }
+  }
+
+  for (size_t i = 0; i < _windows.size(); ++i) {
+    if ((i != 0 && _windows[i].begin.kind == Boundary::kNone) ||
+        (i != _windows.size() - 1 &&
+         _windows[i].end.kind == Boundary::kNone)) {
+      std::cerr << "ERROR: Only the first --cosim-window can begin at reset "
+                   "and only the last\n"
+                   "one can last up to the end of the simulation."
+                << std::endl;
+      return false;
+    }
+  }
+
+  if (_fast_forward.kind != Boundary::kNone && !_windows.empty()) {
+    std::cerr << "ERROR: --fast-forward can't be combined with --cosim-window."
+              << std::endl;
+    return false;
+  }
+  if (_shared_ram && _async) {
+    std::cerr << "ERROR: --cosim-shared-ram can't be combined with "
+                 "--cosim-async."
+              << std::endl;
+    return false;
+  }
+  if (_measure_cycles && _fast_forward.kind == Boundary::kNone) {
+    std::cerr << "ERROR: --fast-forward-measure needs --fast-forward."
+              << std::endl;
+    return false;
+  }
+
+  if (!_server_path.empty()) {
+    std::cerr << "ERROR: --server isn't supported with co-simulation."
+              << std::endl;
+    return false;
+  }
+
+  if (!ResolveSymbols()) {
+    return false;
+  }
+
+  _windowed = !_windows.empty();
+  if (!_windowed) {
+    _windows.push_back(Window());
+  }
+  const Boundary &first_begin = _windows[0].begin;
+  _in_window = first_begin.kind == Boundary::kNone ||
+               (first_begin.kind == Boundary::kCycle && first_begin.value == 0);
+  _windows_entered = _in_window ? 1 : 0;
+
+  return true;
+}
+
+const DemoSystemCosim::Boundary *DemoSystemCosim::NextBoundary() const {
+  if (_window >= _windows.size()) {
+    return nullptr;
+  }
+  const Boundary &boundary =
+      _in_window ? _windows[_window].end : _windows[_window].begin;
+  return boundary.kind == Boundary::kNone ? nullptr : &boundary;
+}
+
+void DemoSystemCosim::ArmBoundary() {
+  int kind = kWindowNone;
+  uint64_t value = 0;
+
+  // The jump to the fast-forward PC is run unchecked, Spike is already there
+  if (_handoff_pending) {
+    cosim_window_arm(false, kWindowNext, 0);
+    return;
+  }
+
+  const Boundary *boundary = NextBoundary();
+  if (boundary) {
+    switch (boundary->kind) {
+      case Boundary::kCycle:
+        // Ends with the next instruction retired, once the cycle is reached
+        if (_cycle_reached || _simctrl.GetTime() / 2 >= boundary->value) {
+          _cycle_reached = true;
+          kind = kWindowNext;
+        }
+        break;
+      case Boundary::kInsns:
+        kind = kWindowInsns;
+        value = boundary->value;
+        break;
+      case Boundary::kPc:
+        kind = kWindowPc;
+        value = boundary->value;
+        break;
+      default:;
+    }
+  }
+
+  cosim_window_arm(_in_window, kind, value);
+}
+
+void DemoSystemCosim::OnWindowBoundary(uint32_t next_pc) {
+  if (_handoff_pending) {
+    CompleteHandoff();
+    ArmBoundary();
+    return;
+  }
+
+  if (_in_window) {
+    ++_window;
+  } else {
+    SyncCosim(next_pc);
+    ++_windows_entered;
+  }
+  _in_window = !_in_window;
+  _cycle_reached = false;
+
+  ArmBoundary();
+}
+
+void DemoSystemCosim::SyncCosim(uint32_t next_pc) {
+  // The checker's scope is set by the DPI call of the boundary
+  uint32_t gprs[32];
+  for (int i = 0; i < 32; ++i) {
+    gprs[i] = cosim_gpr_get(i);
+  }
+  _cosim->set_arch_state(next_pc, gprs);
+
+  for (int csr : kSyncCsrs) {
+    _cosim->set_csr(csr, cosim_csr_get(csr));
+  }
+  _cosim->set_minstret(
+      (static_cast<uint64_t>(cosim_csr_get(CSR_MINSTRETH)) << 32) |
+      cosim_csr_get(CSR_MINSTRET));
+
+  if (!_shared_ram) {
+    CopyMemAreaToCosim(&_ram, kRamBase);
+  }
+}
+
+bool DemoSystemCosim::FastForward() {
+  if (_async_cosim) {
+    _async_cosim->Drain();
+  }
+
+  // The PC might never be reached, e.g. if the software takes another path
+  bool to_pc = _fast_forward.kind == Boundary::kPc;
+  uint64_t max_steps = _fast_forward.value;
+  if (to_pc) {
+    max_steps =
+        _simctrl.GetTimeout() ? _simctrl.GetTimeout() : kFastForwardMaxInsns;
+  }
+  uint64_t steps = _cosim->free_run(max_steps, to_pc, _fast_forward.value);
+
+  uint32_t pc;
+  uint32_t gprs[32];
+  _cosim->get_arch_state(pc, gprs);
+  if (to_pc && pc != _fast_forward.value) {
+    std::cerr << "ERROR: Spike did not reach the --fast-forward PC 0x"
+              << std::hex << _fast_forward.value << std::dec;
+    if (!_fast_forward.symbol.empty()) {
+      std::cerr << " (" << _fast_forward.symbol << ")";
+    }
+    std::cerr << " within " << steps << " instructions." << std::endl;
+    return false;
+  }
+  if (pc < kRamBase || pc - kRamBase >= _ram.GetSizeBytes()) {
+    std::cerr << "ERROR: Spike stopped at PC 0x" << std::hex << pc << std::dec
+              << " outside of the RAM, the core can't continue there."
+              << std::endl;
+    return false;
+  }
+  std::cout << "Fast-forwarded " << steps << " instructions in Spike to PC 0x"
+            << std::hex << pc << std::dec << std::endl;
+
+  for (int i = 0; i < 32; ++i) {
+    cosim_fast_forward_set_gpr(i, gprs[i]);
+  }
+  for (int csr : kHandoffCsrs) {
+    cosim_fast_forward_set_csr(csr, _cosim->get_csr(csr));
+  }
+
+  // The counters of the core start from reset
+  _cosim->set_csr(CSR_MCOUNTINHIBIT, 0);
+  _cosim->set_minstret(0);
+
+  // A shared RAM has been written by Spike already
+  if (!_shared_ram) {
+    std::vector<uint8_t> ram(_ram.GetSizeBytes());
+    _cosim->backdoor_read_mem(kRamBase, ram.size(), ram.data());
+    _ram.Write(0, ram);
+  }
+  if (pc != kResetVector) {
+    uint32_t reset_vector_word = (kResetVector - kRamBase) / 4;
+    std::vector<uint8_t> insn = _ram.Read(reset_vector_word, 1);
+    memcpy(&_reset_vector_insn, insn.data(), sizeof(_reset_vector_insn));
+    uint32_t jump = EncodeJump(static_cast<int32_t>(pc - kResetVector));
+    _ram.Write(reset_vector_word, reinterpret_cast<const uint8_t *>(&jump),
+               sizeof(jump));
+    _handoff_pending = true;
+  }
+
+  if (!_handoff_pending && _measure_cycles) {
+    _measure_end_cycle = _simctrl.GetTime() / 2 + _measure_cycles;
+  }
+  return true;
+}
+
+void DemoSystemCosim::CompleteHandoff() {
+  _handoff_pending = false;
+
+  // The checker's scope is set by the DPI call of the boundary
+  _cosim->set_minstret(
+      (static_cast<uint64_t>(cosim_csr_get(CSR_MINSTRETH)) << 32) |
+      cosim_csr_get(CSR_MINSTRET));
+  if (_measure_cycles) {
+    _measure_end_cycle = _simctrl.GetTime() / 2 + _measure_cycles;
+  }
+
+  _ram.Write((kResetVector - kRamBase) / 4,
+             reinterpret_cast<const uint8_t *>(&_reset_vector_insn),
+             sizeof(_reset_vector_insn));
+}
+
+void DemoSystemCosim::OnClock(unsigned long sim_time) {
+  // Arm the first boundary in the first cycle, after the initial blocks ran.
+  // Later, check whether a cycle boundary has been reached.
+  svSetScope(svGetScopeFromName(_checker_scope.c_str()));
+  if (_fast_forward.kind != Boundary::kNone && !_fast_forwarded) {
+    _fast_forwarded = true;
+    if (!FastForward()) {
+      _simctrl.RequestStop(false);
+      return;
+    }
+  }
+  ArmBoundary();
+
+  if (_measure_end_cycle && sim_time / 2 >= _measure_end_cycle) {
+    std::cout << "Measured " << _measure_cycles
+              << " cycles after the fast-forward" << std::endl;
+    _measure_end_cycle = 0;
+    _simctrl.RequestStop(true);
+  }
+
+  ReportAsyncMismatch();
+}
+
+unsigned long DemoSystemCosim::NextWakeupCycle(unsigned long cycle) {
+  // The handoff completes within a few cycles after reset, the end of the
+  // measurement is only known then
+  if (_handoff_pending) {
+    return cycle + 1;
+  }
+
+  unsigned long wakeup = NextBoundaryWakeupCycle(cycle);
+  if (_measure_end_cycle) {
+    wakeup = std::min(wakeup,
+                      std::max<unsigned long>(_measure_end_cycle, cycle + 1));
+  }
+  if (_async_cosim) {
+    return std::min(wakeup, cycle + kAsyncPollPeriod);
+  }
+  return wakeup;
+}
+
+unsigned long DemoSystemCosim::NextBoundaryWakeupCycle(unsigned long cycle) {
+  const Boundary *boundary = NextBoundary();
+  if (boundary && boundary->kind == Boundary::kCycle) {
+    return _cycle_reached ? kNoWakeup
+                          : std::max<unsigned long>(boundary->value, cycle + 1);
+  }
+
+  // A later cycle boundary can't wake up the simulation controller once it
+  // becomes the next boundary, so poll for it
+  for (size_t i = _window; i < _windows.size(); ++i) {
+    if ((_windows[i].begin.kind == Boundary::kCycle &&
+         !(i == _window && _in_window)) ||
+        _windows[i].end.kind == Boundary::kCycle) {
+      return cycle + kCyclePollPeriod;
+    }
+  }
+  return kNoWakeup;
+}
+
+bool DemoSystemCosim::ReportAsyncMismatch() {
+  if (!_async_cosim || !_async_cosim->Failed()) {
+    return true;
+  }
+  if (_mismatch_reported) {
+    return false;
+  }
+
+  uint64_t cycle;
+  uint32_t pc;
+  std::vector<std::string> errors;
+  _async_cosim->GetMismatch(cycle, pc, errors);
+  std::cout << "FAILURE: Co-simulation mismatch at cycle " << cycle
+            << ", PC 0x" << std::hex << pc << std::dec << std::endl;
+  for (const auto &error : errors) {
+    std::cout << error << std::endl;
+  }
+
+  _mismatch_reported = true;
+  _simctrl.RequestStop(false);
+  return false;
+}
+
+bool DemoSystemCosim::Finish() {
+  if (_async_cosim) {
+    // Mismatches in the instructions retired since the last check
+    _async_cosim->Drain();
+    if (!ReportAsyncMismatch()) {
+      return false;
+    }
+  }
+
+  std::cout << "Co-simulation matched " << _cosim->get_insn_cnt()
+            << " instructions";
+  if (_windowed) {
+    std::cout << " in " << _windows_entered << " windows";
+  }
+  std::cout << std::endl;
+
+  return DemoSystem::Finish();
+}
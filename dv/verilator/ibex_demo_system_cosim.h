@@ -0,0 +1,159 @@
+// Copyright lowRISC contributors.
+// Licensed under the Apache License, Version 2.0, see LICENSE for details.
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef IBEX_DEMO_SYSTEM_COSIM_H_
+#define IBEX_DEMO_SYSTEM_COSIM_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "async_cosim.h"
+#include "cosim.h"
+#include "ibex_demo_system.h"
+
+/**
+ * Demo system checked against the Spike co-simulator
+ *
+ * ibex_demo_system_cosim_checker.sv steps Spike for every instruction the
+ * core retires and compares the results. Loads and stores to the peripherals
+ * aren't modelled by Spike, the loads return the data the core read.
+ *
+ * By default the whole simulation is checked. With --cosim-window checking is
+ * limited to windows between cycle, instruction or symbol boundaries. At the
+ * start of each window Spike takes the state of the core: its PC, registers,
+ * machine-mode CSRs and the RAM. Outside of the windows only the RVFI is
+ * evaluated, so long software can be checked in the parts of interest.
+ *
+ * With --cosim-async Spike is stepped on a worker thread, see AsyncCosim, and
+ * its mismatches are reported with the cycle of the mismatching instruction.
+ *
+ * With --fast-forward Spike first runs the software on its own up to a symbol
+ * or instruction count. Its registers, machine-mode CSRs and RAM are then
+ * handed to the core, which continues from there, checked against Spike.
+ *
+ * With --cosim-shared-ram Spike's memory is the array of the RAM itself,
+ * rather than a copy of it which is written at start-up and at each window.
+ */
+class DemoSystemCosim : public DemoSystem {
+ public:
+  DemoSystemCosim(const char *ram_hier_path, int ram_size_words,
+                  VerilatorSimCtrl &simctrl = VerilatorSimCtrl::GetInstance());
+
+  /**
+   * Create the co-simulator, called by the checker before the simulation
+   * starts
+   */
+  void CreateCosim(bool secure_ibex, bool icache_en, uint32_t pmp_num_regions,
+                   uint32_t pmp_granularity, uint32_t mhpm_counter_num);
+
+  Cosim *GetCosim() { return _cosim.get(); }
+
+  /**
+   * Handle the boundary armed in the checker, called through the DPI when the
+   * core retired the instruction at the boundary
+   *
+   * @param next_pc PC of the instruction after the boundary
+   */
+  void OnWindowBoundary(uint32_t next_pc);
+
+  // Declared in SimCtrlExtension
+  bool ParseCLIArguments(int argc, char **argv, bool &exit_app) override;
+  void OnClock(unsigned long sim_time) override;
+  unsigned long NextWakeupCycle(unsigned long cycle) override;
+
+ protected:
+  std::unique_ptr<Cosim> _cosim;
+
+  virtual bool Finish() override;
+
+ private:
+  struct Boundary {
+    enum Kind {
+      // Not given, i.e. from reset or up to the end of the simulation
+      kNone,
+      kCycle,
+      kInsns,
+      kPc,
+    };
+    Kind kind;
+    uint64_t value;
+    // Symbol to look up the PC of, once the ELF file is known
+    std::string symbol;
+  };
+
+  struct Window {
+    Boundary begin;
+    Boundary end;
+  };
+
+  std::string _checker_scope;
+  std::string _ram_scope;
+  std::string _elf_path;
+  std::vector<Window> _windows;
+  // Windows have been given, otherwise _windows holds one for the whole
+  // simulation
+  bool _windowed;
+  // Window the next boundary belongs to, and whether it is its end
+  size_t _window;
+  bool _in_window;
+  // The cycle boundary has been reached, the next instruction retired ends it
+  bool _cycle_reached;
+  unsigned int _windows_entered;
+  bool _async;
+  // _cosim if --cosim-async is given, otherwise null
+  AsyncCosim *_async_cosim;
+  bool _mismatch_reported;
+  bool _shared_ram;
+  // --fast-forward, kNone if not given
+  Boundary _fast_forward;
+  bool _fast_forwarded;
+  // The core runs the jump to the PC Spike stopped at, see FastForward()
+  bool _handoff_pending;
+  uint32_t _reset_vector_insn;
+  // --fast-forward-measure, and the cycle it ends in once known
+  unsigned long _measure_cycles;
+  unsigned long _measure_end_cycle;
+
+  bool ParseBoundary(const std::string &text, Boundary &boundary);
+  bool ResolveSymbols();
+  const Boundary *NextBoundary() const;
+  unsigned long NextBoundaryWakeupCycle(unsigned long cycle);
+  void ArmBoundary();
+  void SyncCosim(uint32_t next_pc);
+  void CopyMemAreaToCosim(MemArea *area, uint32_t base_addr);
+
+  /**
+   * Get the array of the RAM model for --cosim-shared-ram
+   *
+   * @return null if the array isn't accessible or not laid out like the memory
+   */
+  uint8_t *GetSharedRamData();
+
+  /**
+   * Run Spike up to the --fast-forward boundary and hand its state to the
+   * core, called in the first cycle, before the reset sequence of the
+   * simulation. The checker writes the state into the core once the reset has
+   * been released.
+   *
+   * The core starts at its reset vector, so the instruction there is replaced
+   * by a jump to the PC Spike stopped at. CompleteHandoff() puts it back once
+   * the jump retired.
+   *
+   * @return false if the state can't be handed over
+   */
+  bool FastForward();
+  void CompleteHandoff();
+
+  /**
+   * Report a mismatch found by the worker with --cosim-async and stop the
+   * simulation
+   *
+   * @return false if there has been a mismatch
+   */
+  bool ReportAsyncMismatch();
+};
+
+#endif  // IBEX_DEMO_SYSTEM_COSIM_H_
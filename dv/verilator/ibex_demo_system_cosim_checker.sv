@@ -0,0 +1,309 @@
+// Copyright lowRISC contributors.
+// Licensed under the Apache License, Version 2.0, see LICENSE for details.
+// SPDX-License-Identifier: Apache-2.0
+
+// Checks the core of the demo system against the Spike co-simulator, see
+// dv/verilator/ibex_demo_system_cosim.cc. Bound into ibex_demo_system.
+//
+// Checking can be limited to windows of the simulation. The simulation arms the
+// boundary of the next window with cosim_window_arm(). When the core retires an
+// instruction at that boundary, it calls cosim_window_boundary(), which arms
+// the following boundary. If a window begins, the co-simulator is
+// resynchronized to the state after that instruction and checking starts with
+// the next instruction.
+//
+// After a fast-forward in the co-simulator, the simulation hands its state to
+// the core with cosim_fast_forward_set_gpr() and cosim_fast_forward_set_csr().
+// The registers are written into the core in the first cycle after the reset
+// sequence of the simulation, which starts a few cycles in, has ended.
+module ibex_demo_system_cosim_checker (
+  input clk_i,
+  input rst_ni,
+
+  input logic        host_dmem_req,
+  input logic        host_dmem_gnt,
+  input logic        host_dmem_we,
+  input logic [31:0] host_dmem_addr,
+  input logic [3:0]  host_dmem_be,
+  input logic [31:0] host_dmem_wdata,
+
+  input logic        host_dmem_rvalid,
+  input logic [31:0] host_dmem_rdata,
+  input logic        host_dmem_err
+);
+  import "DPI-C" context function chandle get_spike_cosim;
+  import "DPI-C" context function void create_cosim(bit secure_ibex, bit icache_en,
+    bit [31:0] pmp_num_regions, bit [31:0] pmp_granularity, bit [31:0] mhpm_counter_num);
+  import "DPI-C" context function void cosim_window_boundary(int unsigned next_pc);
+
+  export "DPI-C" function cosim_window_arm;
+  export "DPI-C" function cosim_gpr_get;
+  export "DPI-C" function cosim_csr_get;
+  export "DPI-C" function cosim_fast_forward_set_gpr;
+  export "DPI-C" function cosim_fast_forward_set_csr;
+
+  import ibex_pkg::*;
+
+  // Boundaries armed by cosim_window_arm()
+  typedef enum int {
+    WindowNone  = 0,
+    // The next instruction retired
+    WindowNext  = 1,
+    // The instruction retired when `window_value` instructions have retired
+    WindowInsns = 2,
+    // The next instruction retired which continues at the PC `window_value`
+    WindowPc    = 3
+  } window_kind_e;
+
+  chandle          cosim_handle;
+  bit              check_en;
+  window_kind_e    window_kind;
+  longint unsigned window_value;
+  longint unsigned insn_count;
+  logic [31:0]     gprs [32];
+
+  // State handed over after a fast-forward
+  bit              restore_pending;
+  bit              restore_done;
+  // The reset has been asserted, anything written into the core before is lost
+  bit              rst_seen;
+  logic [31:0]     restore_gprs [32];
+  // status_t of ibex_cs_registers: mie, mpie, mpp, mprv, tw
+  logic [5:0]      restore_mstatus;
+  irqs_t           restore_mie;
+  exc_cause_t      restore_mcause;
+  logic [31:0]     restore_mscratch;
+  logic [31:0]     restore_mepc;
+  logic [31:0]     restore_mtval;
+  logic [31:0]     restore_mtvec;
+
+  initial begin
+    int unsigned pmp_granularity = u_top.PMPEnable ? u_top.PMPGranularity : 0;
+    int unsigned pmp_num_regions = u_top.PMPEnable ? u_top.PMPNumRegions  : 0;
+
+    check_en     = 1'b1;
+    window_kind  = WindowNone;
+    window_value = '0;
+    insn_count   = '0;
+    for (int i = 0; i < 32; i++) begin
+      gprs[i]         = '0;
+      restore_gprs[i] = '0;
+    end
+    restore_pending = 1'b0;
+    restore_done    = 1'b0;
+    rst_seen        = 1'b0;
+
+    create_cosim(u_top.SecureIbex, u_top.ICache, pmp_num_regions, pmp_granularity,
+                 u_top.MHPMCounterNum);
+    cosim_handle = get_spike_cosim();
+  end
+
+  function automatic void cosim_window_arm(bit enable_check, int kind, longint unsigned value);
+    check_en     = enable_check;
+    window_kind  = window_kind_e'(kind);
+    window_value = value;
+  endfunction
+
+  // Registers of the core after the instruction retiring on the RVFI, tracked
+  // through the RVFI so they don't depend on the register file implementation
+  function automatic int unsigned cosim_gpr_get(int index);
+    if (index != 0 && index == int'(u_top.rvfi_rd_addr)) begin
+      return u_top.rvfi_rd_wdata;
+    end
+    return gprs[index];
+  endfunction
+
+  // CSRs of the core which the co-simulator doesn't take from the RVFI at
+  // every step
+  function automatic int unsigned cosim_csr_get(int csr);
+    logic [31:0] value = '0;
+    case (csr_num_e'(csr))
+      CSR_MSTATUS: begin
+        value[CSR_MSTATUS_MIE_BIT]  = u_top.u_ibex_core.cs_registers_i.mstatus_q.mie;
+        value[CSR_MSTATUS_MPIE_BIT] = u_top.u_ibex_core.cs_registers_i.mstatus_q.mpie;
+        value[CSR_MSTATUS_MPP_BIT_HIGH:CSR_MSTATUS_MPP_BIT_LOW] =
+          u_top.u_ibex_core.cs_registers_i.mstatus_q.mpp;
+        value[CSR_MSTATUS_MPRV_BIT] = u_top.u_ibex_core.cs_registers_i.mstatus_q.mprv;
+        value[CSR_MSTATUS_TW_BIT]   = u_top.u_ibex_core.cs_registers_i.mstatus_q.tw;
+      end
+      CSR_MIE: begin
+        value[CSR_MSIX_BIT] = u_top.u_ibex_core.cs_registers_i.mie_q.irq_software;
+        value[CSR_MTIX_BIT] = u_top.u_ibex_core.cs_registers_i.mie_q.irq_timer;
+        value[CSR_MEIX_BIT] = u_top.u_ibex_core.cs_registers_i.mie_q.irq_external;
+        value[CSR_MFIX_BIT_HIGH:CSR_MFIX_BIT_LOW] =
+          u_top.u_ibex_core.cs_registers_i.mie_q.irq_fast;
+      end
+      CSR_MSCRATCH: value = u_top.u_ibex_core.cs_registers_i.mscratch_q;
+      CSR_MTVEC:    value = u_top.u_ibex_core.cs_registers_i.mtvec_q;
+      CSR_MEPC:     value = u_top.u_ibex_core.cs_registers_i.mepc_q;
+      CSR_MCAUSE:   value = {u_top.u_ibex_core.cs_registers_i.mcause_q.irq_ext |
+                             u_top.u_ibex_core.cs_registers_i.mcause_q.irq_int,
+                             u_top.u_ibex_core.cs_registers_i.mcause_q.irq_int ? {26{1'b1}} :
+                                                                                 26'b0,
+                             u_top.u_ibex_core.cs_registers_i.mcause_q.lower_cause[4:0]};
+      CSR_MTVAL:    value = u_top.u_ibex_core.cs_registers_i.mtval_q;
+      CSR_MCOUNTINHIBIT: value = u_top.u_ibex_core.cs_registers_i.mcountinhibit;
+      CSR_MINSTRET:  value = u_top.u_ibex_core.cs_registers_i.mhpmcounter[2][31:0];
+      CSR_MINSTRETH: value = u_top.u_ibex_core.cs_registers_i.mhpmcounter[2][63:32];
+      default: ;
+    endcase
+    return value;
+  endfunction
+
+  function automatic void cosim_fast_forward_set_gpr(int index, int unsigned value);
+    restore_gprs[index] = value;
+    gprs[index]         = value;
+    restore_pending     = 1'b1;
+  endfunction
+
+  // Takes the CSRs read by cosim_csr_get(), apart from the counters
+  function automatic void cosim_fast_forward_set_csr(int csr, int unsigned value);
+    case (csr_num_e'(csr))
+      CSR_MSTATUS: restore_mstatus = {value[CSR_MSTATUS_MIE_BIT], value[CSR_MSTATUS_MPIE_BIT],
+                                      value[CSR_MSTATUS_MPP_BIT_HIGH:CSR_MSTATUS_MPP_BIT_LOW],
+                                      value[CSR_MSTATUS_MPRV_BIT], value[CSR_MSTATUS_TW_BIT]};
+      CSR_MIE: begin
+        restore_mie.irq_software = value[CSR_MSIX_BIT];
+        restore_mie.irq_timer    = value[CSR_MTIX_BIT];
+        restore_mie.irq_external = value[CSR_MEIX_BIT];
+        restore_mie.irq_fast     = value[CSR_MFIX_BIT_HIGH:CSR_MFIX_BIT_LOW];
+      end
+      CSR_MSCRATCH: restore_mscratch = value;
+      CSR_MTVEC:    restore_mtvec    = value;
+      CSR_MEPC:     restore_mepc     = value;
+      CSR_MCAUSE: begin
+        restore_mcause.irq_int     = value[31] & value[30];
+        restore_mcause.irq_ext     = value[31] & ~value[30];
+        restore_mcause.lower_cause = value[4:0];
+      end
+      CSR_MTVAL:    restore_mtval    = value;
+      default: ;
+    endcase
+    restore_pending = 1'b1;
+  endfunction
+
+  // Write the handed over state into the core, assuming the register file of
+  // top_verilator (RegFileFF) and no shadow copies of the CSRs (SecureIbex off).
+  // The state is handed over in cycle 0, before the simulation applies the
+  // reset, so wait for the reset to be released.
+  for (genvar i = 1; i < 32; i++) begin : g_restore_gprs
+    always @(posedge clk_i or negedge rst_ni) begin
+      if (rst_ni && rst_seen && restore_pending && !restore_done) begin
+        u_top.gen_regfile_ff.register_file_i.g_rf_flops[i].rf_reg_q <= restore_gprs[i];
+      end
+    end
+  end
+
+  always @(posedge clk_i or negedge rst_ni) begin
+    if (!rst_ni) begin
+      rst_seen <= 1'b1;
+    end else if (rst_seen && restore_pending && !restore_done) begin
+      u_top.u_ibex_core.cs_registers_i.u_mstatus_csr.rdata_q  <= restore_mstatus;
+      u_top.u_ibex_core.cs_registers_i.u_mie_csr.rdata_q      <= restore_mie;
+      u_top.u_ibex_core.cs_registers_i.u_mscratch_csr.rdata_q <= restore_mscratch;
+      u_top.u_ibex_core.cs_registers_i.u_mtvec_csr.rdata_q    <= restore_mtvec;
+      u_top.u_ibex_core.cs_registers_i.u_mepc_csr.rdata_q     <= restore_mepc;
+      u_top.u_ibex_core.cs_registers_i.u_mcause_csr.rdata_q   <= restore_mcause;
+      u_top.u_ibex_core.cs_registers_i.u_mtval_csr.rdata_q    <= restore_mtval;
+      restore_done <= 1'b1;
+    end
+  end
+
+  function automatic bit window_boundary_hit();
+    case (window_kind)
+      WindowNext:  return 1'b1;
+      WindowInsns: return insn_count + 1 >= window_value;
+      WindowPc:    return u_top.rvfi_pc_wdata == window_value[31:0];
+      default:     return 1'b0;
+    endcase
+  endfunction
+
+  always @(posedge clk_i) begin
+    if (u_top.rvfi_valid) begin
+      if (check_en) begin
+        riscv_cosim_set_nmi(cosim_handle, u_top.rvfi_ext_nmi);
+        riscv_cosim_set_nmi_int(cosim_handle, u_top.rvfi_ext_nmi_int);
+        riscv_cosim_set_mip(cosim_handle, u_top.rvfi_ext_pre_mip, u_top.rvfi_ext_post_mip);
+        riscv_cosim_set_debug_req(cosim_handle, u_top.rvfi_ext_debug_req);
+        riscv_cosim_set_mcycle(cosim_handle, u_top.rvfi_ext_mcycle);
+        for (int i=0; i < 10; i++) begin
+          riscv_cosim_set_csr(cosim_handle, int'(CSR_MHPMCOUNTER3) + i,
+            u_top.rvfi_ext_mhpmcounters[i]);
+          riscv_cosim_set_csr(cosim_handle, int'(CSR_MHPMCOUNTER3H) + i,
+            u_top.rvfi_ext_mhpmcountersh[i]);
+        end
+        riscv_cosim_set_ic_scr_key_valid(cosim_handle, u_top.rvfi_ext_ic_scr_key_valid);
+
+        if (riscv_cosim_step(cosim_handle, u_top.rvfi_rd_addr, u_top.rvfi_rd_wdata,
+                             u_top.rvfi_pc_rdata, u_top.rvfi_trap,
+                             u_top.rvfi_ext_rf_wr_suppress) == 0)
+        begin
+          $display("FAILURE: Co-simulation mismatch at time %t", $time());
+          for (int i = 0;i < riscv_cosim_get_num_errors(cosim_handle); ++i) begin
+            $display(riscv_cosim_get_error(cosim_handle, i));
+          end
+          riscv_cosim_clear_errors(cosim_handle);
+
+          // $error rather than $fatal ends the simulation gracefully, e.g. so
+          // the flight recorder writes the instructions before the mismatch.
+          $error("Co-simulation mismatch seen");
+        end
+      end
+
+      insn_count <= insn_count + 1;
+      if (u_top.rvfi_rd_addr != '0) begin
+        gprs[u_top.rvfi_rd_addr] <= u_top.rvfi_rd_wdata;
+      end
+
+      // Traps have no well-defined state after them to resynchronize to
+      if (!u_top.rvfi_trap && window_boundary_hit()) begin
+        cosim_window_boundary(u_top.rvfi_pc_wdata);
+      end
+    end
+  end
+
+  logic outstanding_store;
+  logic [31:0] outstanding_addr;
+  logic [3:0] outstanding_be;
+  logic [31:0] outstanding_store_data;
+  logic outstanding_misaligned_first;
+  logic outstanding_misaligned_second;
+  logic outstanding_misaligned_first_saw_error;
+  logic outstanding_m_mode_access;
+
+  always @(posedge clk_i or negedge rst_ni) begin
+    if (!rst_ni) begin
+      outstanding_store <= 1'b0;
+    end else begin
+      if (host_dmem_req && host_dmem_gnt) begin
+        outstanding_store      <= host_dmem_we;
+        outstanding_addr       <= host_dmem_addr;
+        outstanding_be         <= host_dmem_be;
+        outstanding_store_data <= host_dmem_wdata;
+        outstanding_misaligned_first <=
+          u_top.u_ibex_core.load_store_unit_i.handle_misaligned_d |
+          ((u_top.u_ibex_core.load_store_unit_i.lsu_type_i == 2'b01) &
+           (u_top.u_ibex_core.load_store_unit_i.data_offset == 2'b01));
+
+        outstanding_misaligned_second <=
+          u_top.u_ibex_core.load_store_unit_i.addr_incr_req_o;
+
+        outstanding_misaligned_first_saw_error <=
+          u_top.u_ibex_core.load_store_unit_i.addr_incr_req_o &
+          u_top.u_ibex_core.load_store_unit_i.lsu_err_d;
+
+        outstanding_m_mode_access <=
+          u_top.u_ibex_core.priv_mode_lsu == ibex_pkg::PRIV_LVL_M;
+      end
+
+      // Accesses outside of the checked windows are dropped, the co-simulator
+      // is resynchronized at the start of the next window
+      if (host_dmem_rvalid && check_en) begin
+        riscv_cosim_notify_dside_access(cosim_handle, outstanding_store, outstanding_addr,
+          outstanding_store ? outstanding_store_data : host_dmem_rdata, outstanding_be,
+          host_dmem_err, outstanding_misaligned_first, outstanding_misaligned_second,
+          outstanding_misaligned_first_saw_error, outstanding_m_mode_access);
+      end
+    end
+  end
+endmodule
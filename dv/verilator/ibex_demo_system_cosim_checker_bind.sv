@@ -0,0 +1,21 @@
+// Copyright lowRISC contributors.
+// Licensed under the Apache License, Version 2.0, see LICENSE for details.
+// SPDX-License-Identifier: Apache-2.0
+
+module ibex_demo_system_cosim_checker_bind;
+  bind ibex_demo_system ibex_demo_system_cosim_checker u_ibex_demo_system_cosim_checker_bind (
+      .clk_i            (clk_sys_i),
+      .rst_ni           (rst_sys_ni),
+
+      .host_dmem_req    (host_req[CoreD]),
+      .host_dmem_gnt    (host_gnt[CoreD]),
+      .host_dmem_we     (host_we[CoreD]),
+      .host_dmem_addr   (host_addr[CoreD]),
+      .host_dmem_be     (host_be[CoreD]),
+      .host_dmem_wdata  (host_wdata[CoreD]),
+
+      .host_dmem_rvalid (host_rvalid[CoreD]),
+      .host_dmem_rdata  (host_rdata[CoreD]),
+      .host_dmem_err    (host_err[CoreD])
+    );
+endmodule
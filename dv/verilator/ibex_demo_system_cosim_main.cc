@@ -0,0 +1,13 @@
+// Copyright lowRISC contributors.
+// Licensed under the Apache License, Version 2.0, see LICENSE for details.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "ibex_demo_system_cosim.h"
+
+int main(int argc, char **argv) {
+  DemoSystemCosim demo_system(
+      "TOP.top_verilator.u_ibex_demo_system.u_ram.u_ram.gen_generic.u_impl_generic",
+      (128 * 1024) / 4);
+
+  return demo_system.Main(argc, argv);
+}
@@ -0,0 +1,188 @@
+// Copyright lowRISC contributors.
+// Licensed under the Apache License, Version 2.0, see LICENSE for details.
+// SPDX-License-Identifier: Apache-2.0
+
+// Runs several simulations of the Ibex Demo System in one process, each with
+// its own software, on a pool of threads. Saves the process start-up costs of
+// running each simulation in its own process.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ibex_demo_system.h"
+#include "verilator_sim_ctrl.h"
+
+namespace {
+const char *const kRamHierPath =
+    "TOP.top_verilator.u_ibex_demo_system.u_ram.u_ram.gen_generic."
+    "u_impl_generic";
+const int kRamSizeWords = 1024 * 1024;
+
+// Arguments are parsed with getopt, which isn't thread-safe
+std::mutex setup_mutex;
+
+// A demo system which parses its arguments while holding setup_mutex
+class DemoSystemJob : public DemoSystem {
+ public:
+  explicit DemoSystemJob(VerilatorSimCtrl &simctrl)
+      : DemoSystem(kRamHierPath, kRamSizeWords, simctrl) {}
+
+ protected:
+  int Setup(int argc, char **argv, bool &exit_app) override {
+    std::lock_guard<std::mutex> lock(setup_mutex);
+    return DemoSystem::Setup(argc, argv, exit_app);
+  }
+};
+
+struct JobResult {
+  bool success;
+  unsigned long cycles;
+  double wallclock_s;
+};
+
+void PrintUsage(const char *prog) {
+  std::cout << "Usage: " << prog
+            << " [-j N|--jobs=N] ELF... [-- SIMULATOR_ARGS...]\n\n"
+               "Simulate the Ibex Demo System once for each ELF, running up "
+               "to N\n"
+               "simulations (default: the number of CPUs) in parallel. "
+               "SIMULATOR_ARGS\n"
+               "are passed to each simulation. Simulation N writes its "
+               "output to\n"
+               "ibex_demo_system_N.log and its performance counters to\n"
+               "ibex_demo_system_pcount_N.csv. Pass --trace=FILE only when "
+               "running a\n"
+               "single simulation.\n";
+}
+
+JobResult RunJob(size_t index, const std::string &elf,
+                 const std::vector<std::string> &sim_args) {
+  std::vector<std::string> args = {"ibex_demo_system"};
+  args.insert(args.end(), sim_args.begin(), sim_args.end());
+  args.push_back("--meminit=ram," + elf);
+  args.push_back("+simulator_ctrl_log=ibex_demo_system_" +
+                 std::to_string(index) + ".log");
+  args.push_back("--pcount-csv=ibex_demo_system_pcount_" +
+                 std::to_string(index) + ".csv");
+
+  std::vector<char *> argv;
+  for (std::string &arg : args) {
+    argv.push_back(&arg[0]);
+  }
+  argv.push_back(nullptr);
+
+  VerilatorSimCtrl simctrl;
+  DemoSystemJob demo_system(simctrl);
+
+  auto start = std::chrono::steady_clock::now();
+  int ret_code = demo_system.Main(args.size(), argv.data());
+  auto end = std::chrono::steady_clock::now();
+
+  JobResult result;
+  result.success = ret_code == 0 && simctrl.WasSimulationSuccessful();
+  result.cycles = simctrl.GetTime() / 2;
+  result.wallclock_s = std::chrono::duration<double>(end - start).count();
+  return result;
+}
+}  // namespace
+
+int main(int argc, char **argv) {
+  unsigned int jobs = std::max(1u, std::thread::hardware_concurrency());
+  std::vector<std::string> elfs;
+  std::vector<std::string> sim_args;
+
+  int i = 1;
+  for (; i < argc; ++i) {
+    const char *arg = argv[i];
+    if (strcmp(arg, "--") == 0) {
+      ++i;
+      break;
+    }
+    if (strcmp(arg, "-h") == 0 || strcmp(arg, "--help") == 0) {
+      PrintUsage(argv[0]);
+      return 0;
+    }
+    const char *jobs_arg = nullptr;
+    if (strcmp(arg, "-j") == 0 && i + 1 < argc) {
+      jobs_arg = argv[++i];
+    } else if (strncmp(arg, "--jobs=", 7) == 0) {
+      jobs_arg = arg + 7;
+    } else if (arg[0] == '-') {
+      std::cerr << "ERROR: Unknown option `" << arg << "'." << std::endl;
+      return 1;
+    } else {
+      elfs.push_back(arg);
+      continue;
+    }
+
+    char *txt_end;
+    jobs = strtoul(jobs_arg, &txt_end, 0);
+    if (*txt_end || !jobs) {
+      std::cerr << "ERROR: Bad number of jobs: `" << jobs_arg << "'."
+                << std::endl;
+      return 1;
+    }
+  }
+  for (; i < argc; ++i) {
+    sim_args.push_back(argv[i]);
+  }
+
+  if (elfs.empty()) {
+    PrintUsage(argv[0]);
+    return 1;
+  }
+
+  std::vector<JobResult> results(elfs.size());
+  std::atomic<size_t> next_job(0);
+  auto worker = [&]() {
+    for (size_t job = next_job++; job < elfs.size(); job = next_job++) {
+      results[job] = RunJob(job, elfs[job], sim_args);
+    }
+  };
+
+  auto start = std::chrono::steady_clock::now();
+  std::vector<std::thread> threads;
+  for (unsigned int t = 0; t < std::min<size_t>(jobs, elfs.size()); ++t) {
+    threads.emplace_back(worker);
+  }
+  for (std::thread &thread : threads) {
+    thread.join();
+  }
+  double wallclock_s = std::chrono::duration<double>(
+                           std::chrono::steady_clock::now() - start)
+                           .count();
+
+  unsigned long total_cycles = 0;
+  size_t failed = 0;
+  std::cout << std::endl
+            << "Simulation results" << std::endl
+            << "==================" << std::endl;
+  for (size_t job = 0; job < elfs.size(); ++job) {
+    const JobResult &result = results[job];
+    std::cout << std::setw(4) << job << "  "
+              << (result.success ? "PASS" : "FAIL") << "  " << std::setw(12)
+              << result.cycles << " cycles  " << std::fixed
+              << std::setprecision(2) << std::setw(8) << result.wallclock_s
+              << " s  " << elfs[job] << std::endl;
+    total_cycles += result.cycles;
+    failed += !result.success;
+  }
+  std::cout << std::endl
+            << "Simulations:      " << elfs.size() << " (" << failed
+            << " failed)" << std::endl
+            << "Executed cycles:  " << total_cycles << std::endl
+            << "Wallclock time:   " << wallclock_s << " s" << std::endl
+            << "Simulation speed: " << total_cycles / wallclock_s
+            << " cycles/s" << std::endl;
+
+  return failed ? 1 : 0;
+}
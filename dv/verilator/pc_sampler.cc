@@ -0,0 +1,243 @@
+// Copyright lowRISC contributors.
+// Licensed under the Apache License, Version 2.0, see LICENSE for details.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "pc_sampler.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <getopt.h>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <vector>
+
+#include "call_profiler.h"
+#include "verilator_sim_ctrl.h"
+
+// DPI export, defined in ibex_demo_system.sv
+extern "C" {
+extern unsigned int pc_sample_get();
+}
+
+PcSampler::PcSampler(VerilatorSimCtrl &simctrl, const std::string &scope,
+                     const CallProfiler &call_profiler)
+    : simctrl_(simctrl),
+      call_profiler_(call_profiler),
+      scope_(scope),
+      sv_scope_(nullptr),
+      interval_(0),
+      out_prefix_("ibex_demo_system_pc_profile"),
+      started_(false),
+      num_samples_(0) {}
+
+bool PcSampler::ParseCLIArguments(int argc, char **argv, bool &exit_app) {
+  const struct option long_options[] = {
+      {"pc-sample-interval", required_argument, nullptr, 'I'},
+      {"pc-sample-elf", required_argument, nullptr, 'E'},
+      {"pc-sample-out", required_argument, nullptr, 'O'},
+      {"help", no_argument, nullptr, 'h'},
+      {nullptr, no_argument, nullptr, 0}};
+
+  // Reset the command parsing index in-case other utils have already parsed
+  // some arguments
+  optind = 1;
+  while (1) {
+    int c = getopt_long(argc, argv, "-:h", long_options, nullptr);
+    if (c == -1) {
+      break;
+    }
+
+    // Disable error reporting by getopt
+    opterr = 0;
+
+    switch (c) {
+      case 'I': {
+        char *txt_end;
+        interval_ = strtoul(optarg, &txt_end, 0);
+        if (*txt_end || !interval_) {
+          std::cerr << "ERROR: --pc-sample-interval must be a positive number "
+                       "of cycles. Got: `"
+                    << optarg << "'." << std::endl;
+          return false;
+        }
+        break;
+      }
+      case 'E':
+        elf_path_ = optarg;
+        break;
+      case 'O':
+        out_prefix_ = optarg;
+        break;
+      case 'h':
+        std::cout << "--pc-sample-interval=CYCLES\n"
+                     "--pc-sample-elf=ELF\n"
+                     "--pc-sample-out=PREFIX\n"
+                     "  Sample the PC every CYCLES cycles and write the "
+                     "profile per\n"
+                     "  function of ELF to PREFIX.samples and PREFIX.flat, "
+                     "and with\n"
+                     "  --call-profile the samples by call stack to "
+                     "PREFIX.folded\n"
+                     "  (default PREFIX: ibex_demo_system_pc_profile)\n\n";
+        return true;
+      case ':':  // missing argument
+        std::cerr << "ERROR: Missing argument." << std::endl << std::endl;
+        return false;
+      default:;
+        // Ignore unrecognized options since they might be consumed by
+        // other utils
+    }
+  }
+
+  if (!elf_path_.empty()) {
+    if (!interval_) {
+      std::cerr << "ERROR: --pc-sample-elf requires --pc-sample-interval."
+                << std::endl;
+      return false;
+    }
+    if (!symbols_.Load(elf_path_)) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+void PcSampler::OnClock(unsigned long sim_time) {
+  if (!interval_) {
+    return;
+  }
+
+  // Nothing has been retired in the first cycle
+  if (!started_) {
+    started_ = true;
+    return;
+  }
+
+  if (!sv_scope_) {
+    sv_scope_ = svGetScopeFromName(scope_.c_str());
+  }
+  svSetScope(sv_scope_);
+  uint32_t pc = pc_sample_get();
+  ++samples_[pc];
+  ++num_samples_;
+
+  std::string stack;
+  if (call_profiler_.FoldedStack(stack)) {
+    ++stack_samples_[std::make_pair(stack, pc)];
+  }
+}
+
+unsigned long PcSampler::NextWakeupCycle(unsigned long cycle) {
+  return interval_ ? cycle + interval_ : kNoWakeup;
+}
+
+void PcSampler::PostExec() {
+  if (started_) {
+    WriteProfiles();
+  }
+  // Start over if the simulation runs again, e.g. in sim server mode
+  samples_.clear();
+  num_samples_ = 0;
+  stack_samples_.clear();
+  started_ = false;
+}
+
+std::string PcSampler::FunctionName(uint32_t pc) const {
+  std::string name;
+  if (!symbols_.FunctionAt(pc, name)) {
+    char addr[16];
+    snprintf(addr, sizeof(addr), "0x%08x", pc);
+    name = addr;
+  }
+  return name;
+}
+
+void PcSampler::WriteProfiles() {
+  // Attribute the samples to functions
+  std::map<std::string, unsigned long> func_samples;
+  for (const auto &pr : samples_) {
+    func_samples[FunctionName(pr.first)] += pr.second;
+  }
+
+  std::vector<std::pair<unsigned long, std::string>> sorted;
+  for (const auto &pr : func_samples) {
+    sorted.emplace_back(pr.second, pr.first);
+  }
+  std::sort(sorted.begin(), sorted.end(),
+            [](const std::pair<unsigned long, std::string> &a,
+               const std::pair<unsigned long, std::string> &b) {
+              return a.first > b.first ||
+                     (a.first == b.first && a.second < b.second);
+            });
+
+  std::string samples_path = out_prefix_ + ".samples";
+  std::ofstream samples(samples_path);
+  for (const auto &pr : sorted) {
+    samples << pr.second << " " << pr.first << "\n";
+  }
+
+  std::string flat_path = out_prefix_ + ".flat";
+  std::ofstream flat(flat_path);
+  flat << "Flat profile:\n\n"
+       << "Each sample counts as " << interval_ << " cycles, " << num_samples_
+       << " samples in " << simctrl_.GetTime() / 2 << " cycles.\n\n"
+       << "  %   cumulative      self\n"
+       << " time      cycles    cycles   samples  name\n";
+  unsigned long cumulative = 0;
+  for (const auto &pr : sorted) {
+    cumulative += pr.first;
+    flat << std::fixed << std::setprecision(2) << std::setw(6)
+         << (num_samples_ ? 100.0 * pr.first / num_samples_ : 0.0) << " "
+         << std::setw(11) << cumulative * interval_ << " " << std::setw(9)
+         << pr.first * interval_ << " " << std::setw(9) << pr.first << "  "
+         << pr.second << "\n";
+  }
+
+  if (!samples || !flat) {
+    std::cerr << "ERROR: Could not write PC profile to `" << samples_path
+              << "' and `" << flat_path << "'." << std::endl;
+    return;
+  }
+
+  std::cout << "PC profile written to " << samples_path << " and " << flat_path
+            << std::endl;
+
+  if (!stack_samples_.empty()) {
+    WriteFolded(out_prefix_ + ".folded");
+  }
+}
+
+bool PcSampler::WriteFolded(const std::string &path) const {
+  // The function of the sampled PC is the leaf, unless the call profiler has
+  // it on top of the stack already
+  std::map<std::string, unsigned long> folded_samples;
+  for (const auto &pr : stack_samples_) {
+    std::string folded = pr.first.first;
+    std::string leaf = FunctionName(pr.first.second);
+    size_t top_pos = folded.rfind(';');
+    top_pos = top_pos == std::string::npos ? 0 : top_pos + 1;
+    if (folded.empty()) {
+      folded = leaf;
+    } else if (folded.compare(top_pos, std::string::npos, leaf) != 0) {
+      folded += ';' + leaf;
+    }
+    folded_samples[folded] += pr.second;
+  }
+
+  std::ofstream out(path);
+  for (const auto &pr : folded_samples) {
+    out << pr.first << " " << pr.second << "\n";
+  }
+
+  if (!out) {
+    std::cerr << "ERROR: Could not write PC profile to `" << path << "'."
+              << std::endl;
+    return false;
+  }
+  std::cout << "PC profile by call stack written to " << path << std::endl;
+  return true;
+}
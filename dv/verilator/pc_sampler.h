@@ -0,0 +1,78 @@
+// Copyright lowRISC contributors.
+// Licensed under the Apache License, Version 2.0, see LICENSE for details.
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef PC_SAMPLER_H_
+#define PC_SAMPLER_H_
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <svdpi.h>
+#include <unordered_map>
+#include <utility>
+
+#include "elf_symbols.h"
+#include "sim_ctrl_extension.h"
+
+class CallProfiler;
+class VerilatorSimCtrl;
+
+/**
+ * Statistical profiler sampling the PC of the core
+ *
+ * With --pc-sample-interval=CYCLES, the PC of the instruction retired last is
+ * sampled every CYCLES cycles. At the end of the simulation, the samples are
+ * attributed to the functions of the ELF file given with --pc-sample-elf and
+ * written to two files:
+ *
+ * - PREFIX.samples: one "FUNCTION SAMPLES" line per function, for further
+ *   processing.
+ * - PREFIX.flat: a flat profile in the style of gprof, with the cycles
+ *   estimated from the samples.
+ * - PREFIX.folded: with --call-profile, the samples by call stack in the
+ *   folded format of flamegraph.pl. The stack is taken from the shadow call
+ *   stack of the CallProfiler at each sample.
+ *
+ * PREFIX is set with --pc-sample-out. Samples outside of any function are
+ * attributed to their address.
+ */
+class PcSampler : public SimCtrlExtension {
+ public:
+  /**
+   * @param simctrl Simulation controller to get the simulation time from
+   * @param scope DPI scope of the module exporting pc_sample_get()
+   * @param call_profiler Call profiler to take the call stacks from
+   */
+  PcSampler(VerilatorSimCtrl &simctrl, const std::string &scope,
+            const CallProfiler &call_profiler);
+
+  // Declared in SimCtrlExtension
+  bool ParseCLIArguments(int argc, char **argv, bool &exit_app) override;
+  void OnClock(unsigned long sim_time) override;
+  unsigned long NextWakeupCycle(unsigned long cycle) override;
+  void PostExec() override;
+
+ private:
+  VerilatorSimCtrl &simctrl_;
+  const CallProfiler &call_profiler_;
+  std::string scope_;
+  svScope sv_scope_;
+  unsigned long interval_;
+  std::string elf_path_;
+  std::string out_prefix_;
+  ElfSymbols symbols_;
+  bool started_;
+
+  // Number of samples by PC
+  std::unordered_map<uint32_t, unsigned long> samples_;
+  unsigned long num_samples_;
+  // Number of samples by folded call stack of the callers and PC
+  std::map<std::pair<std::string, uint32_t>, unsigned long> stack_samples_;
+
+  std::string FunctionName(uint32_t pc) const;
+  void WriteProfiles();
+  bool WriteFolded(const std::string &path) const;
+};
+
+#endif  // PC_SAMPLER_H_
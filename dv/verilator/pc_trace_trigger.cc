@@ -0,0 +1,109 @@
+// Copyright lowRISC contributors.
+// Licensed under the Apache License, Version 2.0, see LICENSE for details.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "pc_trace_trigger.h"
+
+#include <cstdlib>
+#include <getopt.h>
+#include <iostream>
+#include <svdpi.h>
+
+#include "elf_symbols.h"
+#include "verilator_sim_ctrl.h"
+
+// DPI export, defined in ibex_demo_system.sv
+extern "C" {
+extern void pc_trace_trigger_set(svBit enable, unsigned int pc);
+}
+
+// DPI import, called by ibex_demo_system.sv when the PC matches
+extern "C" void pc_trace_trigger_hit() {
+  VerilatorSimCtrl::GetInstance().TriggerTrace();
+}
+
+PcTraceTrigger::PcTraceTrigger(VerilatorSimCtrl &simctrl,
+                               const std::string &scope)
+    : simctrl_(simctrl), scope_(scope), enabled_(false), pc_(0) {}
+
+bool PcTraceTrigger::ParseCLIArguments(int argc, char **argv, bool &exit_app) {
+  const struct option long_options[] = {
+      {"trace-trigger", required_argument, nullptr, 'T'},
+      {"help", no_argument, nullptr, 'h'},
+      {nullptr, no_argument, nullptr, 0}};
+
+  // Reset the command parsing index in-case other utils have already parsed
+  // some arguments
+  optind = 1;
+  while (1) {
+    int c = getopt_long(argc, argv, "-:h", long_options, nullptr);
+    if (c == -1) {
+      break;
+    }
+
+    // Disable error reporting by getopt
+    opterr = 0;
+
+    switch (c) {
+      case 'T':
+        if (!ParseTriggerArg(optarg)) {
+          return false;
+        }
+        enabled_ = true;
+        simctrl_.DeferTraceStart();
+        break;
+      case 'h':
+        std::cout << "--trace-trigger=ADDR\n"
+                     "--trace-trigger=SYMBOL,ELF\n"
+                     "  Start tracing when the core retires the instruction "
+                     "at ADDR or\n"
+                     "  at SYMBOL of the ELF file ELF\n\n";
+        return true;
+      case ':':  // missing argument
+        std::cerr << "ERROR: Missing argument." << std::endl << std::endl;
+        return false;
+      default:;
+        // Ignore unrecognized options since they might be consumed by
+        // other utils
+    }
+  }
+
+  return true;
+}
+
+bool PcTraceTrigger::ParseTriggerArg(const std::string &arg) {
+  size_t comma_pos = arg.find(',');
+  if (comma_pos == std::string::npos) {
+    char *txt_end;
+    pc_ = strtoul(arg.c_str(), &txt_end, 0);
+    if (arg.empty() || *txt_end) {
+      std::cerr << "ERROR: --trace-trigger must be of the form ADDR or "
+                   "SYMBOL,ELF. Got: `"
+                << arg << "'." << std::endl;
+      return false;
+    }
+    return true;
+  }
+
+  std::string symbol = arg.substr(0, comma_pos);
+  std::string elf_path = arg.substr(comma_pos + 1);
+  ElfSymbols symbols;
+  if (!symbols.Load(elf_path)) {
+    return false;
+  }
+  if (!symbols.Lookup(symbol, pc_)) {
+    std::cerr << "ERROR: No symbol `" << symbol << "' in `" << elf_path
+              << "'." << std::endl;
+    return false;
+  }
+  return true;
+}
+
+void PcTraceTrigger::OnClock(unsigned long sim_time) {
+  // Arm the trigger in the first cycle, after the initial blocks ran
+  if (!enabled_) {
+    return;
+  }
+  svSetScope(svGetScopeFromName(scope_.c_str()));
+  pc_trace_trigger_set(1, pc_);
+}
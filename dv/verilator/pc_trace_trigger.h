@@ -0,0 +1,48 @@
+// Copyright lowRISC contributors.
+// Licensed under the Apache License, Version 2.0, see LICENSE for details.
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef PC_TRACE_TRIGGER_H_
+#define PC_TRACE_TRIGGER_H_
+
+#include <cstdint>
+#include <string>
+
+#include "sim_ctrl_extension.h"
+
+class VerilatorSimCtrl;
+
+/**
+ * Trigger tracing when the core retires the instruction at a given PC
+ *
+ * The PC is given with --trace-trigger, either as address or as symbol of an
+ * ELF file. The design compares the PC of every retired instruction and calls
+ * back into the simulation controller on a match, see
+ * pc_trace_trigger_set() in ibex_demo_system.sv. --trace and --trace-stop
+ * then trace from the trigger rather than from the start.
+ */
+class PcTraceTrigger : public SimCtrlExtension {
+ public:
+  /**
+   * @param simctrl Simulation controller to defer the start of tracing in
+   * @param scope DPI scope of the module exporting pc_trace_trigger_set()
+   */
+  PcTraceTrigger(VerilatorSimCtrl &simctrl, const std::string &scope);
+
+  // Declared in SimCtrlExtension
+  bool ParseCLIArguments(int argc, char **argv, bool &exit_app) override;
+  void OnClock(unsigned long sim_time) override;
+  unsigned long NextWakeupCycle(unsigned long cycle) override {
+    return kNoWakeup;
+  }
+
+ private:
+  VerilatorSimCtrl &simctrl_;
+  std::string scope_;
+  bool enabled_;
+  uint32_t pc_;
+
+  bool ParseTriggerArg(const std::string &arg);
+};
+
+#endif  // PC_TRACE_TRIGGER_H_
@@ -0,0 +1,272 @@
+// Copyright lowRISC contributors.
+// Licensed under the Apache License, Version 2.0, see LICENSE for details.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "pcount_series.h"
+
+#include <cctype>
+#include <cstdlib>
+#include <getopt.h>
+#include <iostream>
+#include <svdpi.h>
+
+#include "ibex_pcounts.h"
+#include "verilator_sim_ctrl.h"
+
+// DPI exports, defined in ibex_demo_system.sv
+extern "C" {
+extern unsigned int mhpmcounter_num();
+extern unsigned long long mhpmcounter_get(int index);
+}
+
+// Index of the instructions retired counter (minstret)
+static const int kInstretCounter = 2;
+// Index of the first counter configured by MHPMCounterNum
+static const int kFirstHpmCounter = 3;
+// Counters of cycles in which the core stalls
+static const int kStallCounters[] = {3, 4, 11, 12};
+
+static std::string ColumnName(const std::string &counter_name) {
+  std::string name;
+  for (char c : counter_name) {
+    name += c == ' ' ? '_' : tolower(c);
+  }
+  return name;
+}
+
+static void WriteLittleEndian(std::ostream &os, uint64_t value, int size) {
+  for (int i = 0; i < size; ++i) {
+    os.put(value >> (8 * i));
+  }
+}
+
+static void WriteLeb128(std::ostream &os, uint64_t value) {
+  do {
+    uint8_t byte = value & 0x7f;
+    value >>= 7;
+    os.put(value ? byte | 0x80 : byte);
+  } while (value);
+}
+
+PcountSeries::PcountSeries(VerilatorSimCtrl &simctrl, const std::string &scope)
+    : simctrl_(simctrl),
+      scope_(scope),
+      interval_(0),
+      out_prefix_("ibex_demo_system_pcount_series"),
+      write_csv_(true),
+      write_bin_(true),
+      started_(false),
+      last_cycle_(0) {}
+
+bool PcountSeries::ParseCLIArguments(int argc, char **argv, bool &exit_app) {
+  const struct option long_options[] = {
+      {"pcount-interval", required_argument, nullptr, 'I'},
+      {"pcount-series", required_argument, nullptr, 'O'},
+      {"pcount-series-format", required_argument, nullptr, 'F'},
+      {"help", no_argument, nullptr, 'h'},
+      {nullptr, no_argument, nullptr, 0}};
+
+  // Reset the command parsing index in-case other utils have already parsed
+  // some arguments
+  optind = 1;
+  while (1) {
+    int c = getopt_long(argc, argv, "-:h", long_options, nullptr);
+    if (c == -1) {
+      break;
+    }
+
+    // Disable error reporting by getopt
+    opterr = 0;
+
+    switch (c) {
+      case 'I': {
+        char *txt_end;
+        interval_ = strtoul(optarg, &txt_end, 0);
+        if (*txt_end || !interval_) {
+          std::cerr << "ERROR: --pcount-interval must be a positive number of "
+                       "cycles. Got: `"
+                    << optarg << "'." << std::endl;
+          return false;
+        }
+        break;
+      }
+      case 'O':
+        out_prefix_ = optarg;
+        break;
+      case 'F': {
+        std::string format(optarg);
+        write_csv_ = format == "csv" || format == "both";
+        write_bin_ = format == "bin" || format == "both";
+        if (!write_csv_ && !write_bin_) {
+          std::cerr << "ERROR: --pcount-series-format must be one of 'csv', "
+                       "'bin' or 'both'. Got: `"
+                    << optarg << "'." << std::endl;
+          return false;
+        }
+        break;
+      }
+      case 'h':
+        std::cout << "--pcount-interval=CYCLES\n"
+                     "--pcount-series=PREFIX\n"
+                     "--pcount-series-format=csv|bin|both\n"
+                     "  Write the increments of the performance counters in "
+                     "every CYCLES\n"
+                     "  cycles to PREFIX.csv and/or PREFIX.bin (default "
+                     "PREFIX:\n"
+                     "  ibex_demo_system_pcount_series, default format: "
+                     "both)\n\n";
+        return true;
+      case ':':  // missing argument
+        std::cerr << "ERROR: Missing argument." << std::endl << std::endl;
+        return false;
+      default:;
+        // Ignore unrecognized options since they might be consumed by
+        // other utils
+    }
+  }
+
+  return true;
+}
+
+void PcountSeries::OnClock(unsigned long sim_time) {
+  if (!interval_) {
+    return;
+  }
+
+  unsigned long cycle = sim_time / 2;
+  if (!started_) {
+    started_ = Start(cycle);
+    return;
+  }
+
+  WriteInterval(cycle);
+}
+
+unsigned long PcountSeries::NextWakeupCycle(unsigned long cycle) {
+  return started_ ? cycle + interval_ : kNoWakeup;
+}
+
+void PcountSeries::PostExec() {
+  if (started_) {
+    unsigned long cycle = simctrl_.GetTime() / 2;
+    if (cycle > last_cycle_) {
+      WriteInterval(cycle);
+    }
+    csv_.close();
+    bin_.close();
+    std::cout << "Performance counter series written to " << out_prefix_
+              << (write_csv_ && write_bin_ ? ".{csv,bin}"
+                  : write_csv_             ? ".csv"
+                                           : ".bin")
+              << std::endl;
+  }
+  // Start over if the simulation runs again, e.g. in sim server mode
+  started_ = false;
+}
+
+bool PcountSeries::Start(unsigned long cycle) {
+  svSetScope(svGetScopeFromName(scope_.c_str()));
+
+  counters_.clear();
+  int num_counters = kFirstHpmCounter + mhpmcounter_num();
+  for (int i = 0; i < (int)ibex_counter_names.size() && i < num_counters;
+       ++i) {
+    if (i == 0 || i >= kInstretCounter) {
+      counters_.push_back(i);
+    }
+  }
+
+  if (write_csv_) {
+    csv_.open(out_prefix_ + ".csv");
+    csv_ << "cycle,interval_cycles";
+    for (int i : counters_) {
+      csv_ << "," << ColumnName(ibex_counter_names[i]);
+    }
+    csv_ << ",ipc";
+    for (int stall_counter : kStallCounters) {
+      for (int i : counters_) {
+        if (i == stall_counter) {
+          csv_ << "," << ColumnName(ibex_counter_names[i]) << "_fraction";
+        }
+      }
+    }
+    csv_ << "\n";
+  }
+
+  if (write_bin_) {
+    bin_.open(out_prefix_ + ".bin", std::ios::binary);
+    bin_.write("IBXPCS1\n", 8);
+    WriteLittleEndian(bin_, interval_, 4);
+    WriteLittleEndian(bin_, cycle, 8);
+    WriteLittleEndian(bin_, counters_.size(), 4);
+    for (int i : counters_) {
+      const std::string &name = ibex_counter_names[i];
+      bin_.put(i);
+      bin_.put(name.size());
+      bin_ << name;
+    }
+  }
+
+  if ((write_csv_ && !csv_) || (write_bin_ && !bin_)) {
+    std::cerr << "ERROR: Could not write performance counter series to `"
+              << out_prefix_ << "'." << std::endl;
+    csv_.close();
+    bin_.close();
+    return false;
+  }
+
+  ReadCounters(last_values_);
+  last_cycle_ = cycle;
+  return true;
+}
+
+void PcountSeries::ReadCounters(std::vector<uint64_t> &values) const {
+  svSetScope(svGetScopeFromName(scope_.c_str()));
+  values.resize(counters_.size());
+  for (size_t i = 0; i < counters_.size(); ++i) {
+    values[i] = mhpmcounter_get(counters_[i]);
+  }
+}
+
+void PcountSeries::WriteInterval(unsigned long cycle) {
+  std::vector<uint64_t> values;
+  ReadCounters(values);
+
+  unsigned long cycles = cycle - last_cycle_;
+  std::vector<uint64_t> deltas(values.size());
+  for (size_t i = 0; i < values.size(); ++i) {
+    // The software may have reset the counter during the interval
+    deltas[i] = values[i] >= last_values_[i] ? values[i] - last_values_[i]
+                                             : values[i];
+  }
+
+  if (write_csv_) {
+    csv_ << cycle << "," << cycles;
+    uint64_t instret = 0;
+    for (size_t i = 0; i < deltas.size(); ++i) {
+      csv_ << "," << deltas[i];
+      if (counters_[i] == kInstretCounter) {
+        instret = deltas[i];
+      }
+    }
+    csv_ << "," << (cycles ? (double)instret / cycles : 0.0);
+    for (int stall_counter : kStallCounters) {
+      for (size_t i = 0; i < deltas.size(); ++i) {
+        if (counters_[i] == stall_counter) {
+          csv_ << "," << (cycles ? (double)deltas[i] / cycles : 0.0);
+        }
+      }
+    }
+    csv_ << "\n";
+  }
+
+  if (write_bin_) {
+    WriteLeb128(bin_, cycles);
+    for (uint64_t delta : deltas) {
+      WriteLeb128(bin_, delta);
+    }
+  }
+
+  last_values_ = values;
+  last_cycle_ = cycle;
+}
@@ -0,0 +1,73 @@
+// Copyright lowRISC contributors.
+// Licensed under the Apache License, Version 2.0, see LICENSE for details.
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef PCOUNT_SERIES_H_
+#define PCOUNT_SERIES_H_
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "sim_ctrl_extension.h"
+
+class VerilatorSimCtrl;
+
+/**
+ * Time series of the performance counters
+ *
+ * With --pcount-interval=CYCLES, all performance counters are read every
+ * CYCLES cycles and at the end of the simulation. The increments of each
+ * interval are written as one row to PREFIX.csv, together with the IPC and the
+ * fractions of the interval's cycles stalled on the LSU, instruction fetch,
+ * multiplier and divider. The same increments are written to PREFIX.bin in a
+ * compact binary form:
+ *
+ * - Header: the magic "IBXPCS1\n", the interval as little endian uint32, the
+ *   start cycle as uint64 and the number of counters N as uint32, then N times
+ *   the counter index and the length of the counter name as uint8, followed
+ *   by the name.
+ * - One record per interval: the number of cycles, then the increments of the
+ *   N counters, each as an unsigned LEB128 number.
+ *
+ * util/pcount_series.py converts PREFIX.bin into the CSV form. PREFIX is set
+ * with --pcount-series and the formats written with --pcount-series-format.
+ */
+class PcountSeries : public SimCtrlExtension {
+ public:
+  /**
+   * @param simctrl Simulation controller to get the simulation time from
+   * @param scope DPI scope of the module exporting mhpmcounter_get()
+   */
+  PcountSeries(VerilatorSimCtrl &simctrl, const std::string &scope);
+
+  // Declared in SimCtrlExtension
+  bool ParseCLIArguments(int argc, char **argv, bool &exit_app) override;
+  void OnClock(unsigned long sim_time) override;
+  unsigned long NextWakeupCycle(unsigned long cycle) override;
+  void PostExec() override;
+
+ private:
+  VerilatorSimCtrl &simctrl_;
+  std::string scope_;
+  unsigned long interval_;
+  std::string out_prefix_;
+  bool write_csv_;
+  bool write_bin_;
+  std::ofstream csv_;
+  std::ofstream bin_;
+  bool started_;
+
+  // Indices of the counters present in the design
+  std::vector<int> counters_;
+  // Counter values and cycle at the end of the last interval
+  std::vector<uint64_t> last_values_;
+  unsigned long last_cycle_;
+
+  bool Start(unsigned long cycle);
+  void ReadCounters(std::vector<uint64_t> &values) const;
+  void WriteInterval(unsigned long cycle);
+};
+
+#endif  // PCOUNT_SERIES_H_
@@ -0,0 +1,212 @@
+// Copyright lowRISC contributors.
+// Licensed under the Apache License, Version 2.0, see LICENSE for details.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "perf_regions.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <fstream>
+#include <getopt.h>
+#include <iomanip>
+#include <iostream>
+#include <svdpi.h>
+
+#include "ibex_pcounts.h"
+#include "verilator_sim_ctrl.h"
+
+// DPI exports, defined in ibex_demo_system.sv
+extern "C" {
+extern unsigned int mhpmcounter_num();
+extern unsigned long long mhpmcounter_get(int index);
+extern void perf_regions_set(void *regions);
+}
+
+// DPI import, called by ibex_demo_system.sv when the software writes a region
+// register of simulator_ctrl
+extern "C" void perf_region_event(void *regions, svBit region_end,
+                                  unsigned int id) {
+  static_cast<PerfRegions *>(regions)->OnRegion(region_end, id);
+}
+
+// Index of the first counter configured by MHPMCounterNum
+static const int kFirstHpmCounter = 3;
+
+static std::string ColumnName(const std::string &counter_name) {
+  std::string name;
+  for (char c : counter_name) {
+    name += c == ' ' ? '_' : tolower(c);
+  }
+  return name;
+}
+
+PerfRegions::PerfRegions(VerilatorSimCtrl &simctrl, const std::string &scope)
+    : simctrl_(simctrl),
+      scope_(scope),
+      csv_path_("ibex_demo_system_perf_regions.csv"),
+      unmatched_ends_(0) {}
+
+bool PerfRegions::ParseCLIArguments(int argc, char **argv, bool &exit_app) {
+  const struct option long_options[] = {
+      {"perf-regions-csv", required_argument, nullptr, 'R'},
+      {"help", no_argument, nullptr, 'h'},
+      {nullptr, no_argument, nullptr, 0}};
+
+  // Reset the command parsing index in-case other utils have already parsed
+  // some arguments
+  optind = 1;
+  while (1) {
+    int c = getopt_long(argc, argv, "-:h", long_options, nullptr);
+    if (c == -1) {
+      break;
+    }
+
+    // Disable error reporting by getopt
+    opterr = 0;
+
+    switch (c) {
+      case 'R':
+        csv_path_ = optarg;
+        break;
+      case 'h':
+        std::cout << "--perf-regions-csv=FILE\n"
+                     "  Write the measurement regions of the software to FILE, "
+                     "default:\n"
+                     "  ibex_demo_system_perf_regions.csv\n\n";
+        return true;
+      case ':':  // missing argument
+        std::cerr << "ERROR: Missing argument." << std::endl << std::endl;
+        return false;
+      default:;
+        // Ignore unrecognized options since they might be consumed by
+        // other utils
+    }
+  }
+
+  return true;
+}
+
+void PerfRegions::OnClock(unsigned long sim_time) {
+  // Receive the regions in the first cycle, after the initial blocks ran
+  svSetScope(svGetScopeFromName(scope_.c_str()));
+  perf_regions_set(this);
+}
+
+void PerfRegions::PostExec() {
+  if (!regions_.empty() || unmatched_ends_) {
+    Report();
+  }
+
+  // Start over if the simulation runs again, e.g. in sim server mode
+  counters_.clear();
+  regions_.clear();
+  unmatched_ends_ = 0;
+}
+
+void PerfRegions::OnRegion(bool region_end, uint32_t id) {
+  if (counters_.empty()) {
+    int num_counters = kFirstHpmCounter + mhpmcounter_num();
+    for (int i = 0; i < (int)ibex_counter_names.size() && i < num_counters;
+         ++i) {
+      if (i != 1) {
+        counters_.push_back(i);
+      }
+    }
+  }
+
+  unsigned long cycle = simctrl_.GetTime() / 2;
+  std::vector<uint64_t> values;
+  ReadCounters(values);
+
+  Region &region = regions_[id];
+  if (!region_end) {
+    region.open.emplace_back(cycle, std::move(values));
+    return;
+  }
+
+  if (region.open.empty()) {
+    ++unmatched_ends_;
+    return;
+  }
+
+  const auto &begin = region.open.back();
+  unsigned long cycles = cycle - begin.first;
+  if (!region.runs || cycles < region.min_cycles) {
+    region.min_cycles = cycles;
+  }
+  region.max_cycles = std::max(region.max_cycles, cycles);
+  region.total_cycles += cycles;
+  ++region.runs;
+
+  region.counter_totals.resize(counters_.size());
+  for (size_t i = 0; i < counters_.size(); ++i) {
+    // The software may have reset the counter during the region
+    region.counter_totals[i] += values[i] >= begin.second[i]
+                                    ? values[i] - begin.second[i]
+                                    : values[i];
+  }
+  region.open.pop_back();
+}
+
+void PerfRegions::ReadCounters(std::vector<uint64_t> &values) {
+  // Called from a DPI context import, the scope is the design already
+  values.resize(counters_.size());
+  for (size_t i = 0; i < counters_.size(); ++i) {
+    values[i] = mhpmcounter_get(counters_[i]);
+  }
+}
+
+void PerfRegions::Report() const {
+  std::cout << "\nPerformance Regions" << std::endl
+            << "===================" << std::endl
+            << "    Region      Runs  Min cycles  Avg cycles  Max cycles  "
+               "Total cycles"
+            << std::endl;
+
+  std::ofstream csv(csv_path_);
+  csv << "region,runs,min_cycles,avg_cycles,max_cycles,total_cycles";
+  for (int i : counters_) {
+    csv << "," << ColumnName(ibex_counter_names[i]);
+  }
+  csv << "\n";
+
+  unsigned long unfinished = 0;
+  for (const auto &pr : regions_) {
+    const Region &region = pr.second;
+    unfinished += region.open.size();
+    if (!region.runs) {
+      continue;
+    }
+
+    char avg_cycles[32];
+    snprintf(avg_cycles, sizeof(avg_cycles), "%.1f",
+             (double)region.total_cycles / region.runs);
+    std::cout << std::setw(10) << pr.first << std::setw(10) << region.runs
+              << std::setw(12) << region.min_cycles << std::setw(12)
+              << avg_cycles << std::setw(12) << region.max_cycles
+              << std::setw(14) << region.total_cycles << std::endl;
+
+    csv << pr.first << "," << region.runs << "," << region.min_cycles << ","
+        << avg_cycles << "," << region.max_cycles << ","
+        << region.total_cycles;
+    for (uint64_t total : region.counter_totals) {
+      csv << "," << total;
+    }
+    csv << "\n";
+  }
+
+  if (unfinished) {
+    std::cout << "WARNING: " << unfinished
+              << " regions began but didn't end." << std::endl;
+  }
+  if (unmatched_ends_) {
+    std::cout << "WARNING: " << unmatched_ends_
+              << " regions ended without beginning." << std::endl;
+  }
+
+  if (!csv) {
+    std::cerr << "ERROR: Could not write performance regions to `"
+              << csv_path_ << "'." << std::endl;
+  }
+}
@@ -0,0 +1,75 @@
+// Copyright lowRISC contributors.
+// Licensed under the Apache License, Version 2.0, see LICENSE for details.
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef PERF_REGIONS_H_
+#define PERF_REGIONS_H_
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "sim_ctrl_extension.h"
+
+class VerilatorSimCtrl;
+
+/**
+ * Measurement regions delimited by the software
+ *
+ * The software begins and ends a region by writing its ID to simulator_ctrl,
+ * see perf_region_begin() in sw/c/common/demo_system.h. The cycle and all
+ * performance counters are read at the begin and end of each region. At the
+ * end of the simulation, the number of times each region ran, the minimum,
+ * average and maximum cycles of a run and the totals of all counters are
+ * printed and written to a CSV file, set with --perf-regions-csv.
+ *
+ * Regions with different IDs may overlap. A region nested in a region with
+ * the same ID (e.g. in a recursive function) is counted as a separate run.
+ */
+class PerfRegions : public SimCtrlExtension {
+ public:
+  /**
+   * @param simctrl Simulation controller to get the simulation time from
+   * @param scope DPI scope of the module exporting perf_regions_set()
+   */
+  PerfRegions(VerilatorSimCtrl &simctrl, const std::string &scope);
+
+  // Declared in SimCtrlExtension
+  bool ParseCLIArguments(int argc, char **argv, bool &exit_app) override;
+  void OnClock(unsigned long sim_time) override;
+  unsigned long NextWakeupCycle(unsigned long cycle) override {
+    return kNoWakeup;
+  }
+  void PostExec() override;
+
+  /**
+   * Begin or end the region \p id, called through the DPI
+   */
+  void OnRegion(bool region_end, uint32_t id);
+
+ private:
+  struct Region {
+    unsigned long runs;
+    unsigned long min_cycles;
+    unsigned long max_cycles;
+    unsigned long total_cycles;
+    // Totals of the counters in counters_
+    std::vector<uint64_t> counter_totals;
+    // Cycle and counter values at the begin of the runs in progress
+    std::vector<std::pair<unsigned long, std::vector<uint64_t>>> open;
+  };
+
+  VerilatorSimCtrl &simctrl_;
+  std::string scope_;
+  std::string csv_path_;
+  // Indices of the counters present in the design
+  std::vector<int> counters_;
+  std::map<uint32_t, Region> regions_;
+  unsigned long unmatched_ends_;
+
+  void ReadCounters(std::vector<uint64_t> &values);
+  void Report() const;
+};
+
+#endif  // PERF_REGIONS_H_
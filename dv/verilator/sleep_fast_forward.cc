@@ -0,0 +1,89 @@
+// Copyright lowRISC contributors.
+// Licensed under the Apache License, Version 2.0, see LICENSE for details.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "sleep_fast_forward.h"
+
+#include <getopt.h>
+#include <iostream>
+#include <svdpi.h>
+
+#include "verilator_sim_ctrl.h"
+
+// DPI exports, defined in ibex_demo_system.sv and timer.sv
+extern "C" {
+extern unsigned long long sleep_skippable_cycles();
+extern void timer_skip_cycles(unsigned long long cycles);
+}
+
+// Cycles between checks whether the core sleeps. The core can fall asleep at
+// most this many cycles before the fast-forward starts.
+static const unsigned long kCheckPeriod = 32;
+
+SleepFastForward::SleepFastForward(VerilatorSimCtrl &simctrl,
+                                   const std::string &scope,
+                                   const std::string &timer_scope)
+    : simctrl_(simctrl),
+      scope_(scope),
+      timer_scope_(timer_scope),
+      enabled_(false) {}
+
+bool SleepFastForward::ParseCLIArguments(int argc, char **argv,
+                                         bool &exit_app) {
+  const struct option long_options[] = {
+      {"fast-forward-sleep", no_argument, nullptr, 'F'},
+      {"help", no_argument, nullptr, 'h'},
+      {nullptr, no_argument, nullptr, 0}};
+
+  // Reset the command parsing index in-case other utils have already parsed
+  // some arguments
+  optind = 1;
+  while (1) {
+    int c = getopt_long(argc, argv, "-:h", long_options, nullptr);
+    if (c == -1) {
+      break;
+    }
+
+    // Disable error reporting by getopt
+    opterr = 0;
+
+    switch (c) {
+      case 'F':
+        enabled_ = true;
+        break;
+      case 'h':
+        std::cout << "--fast-forward-sleep\n"
+                     "  Skip the cycles in which the core sleeps until the "
+                     "next timer\n"
+                     "  interrupt\n\n";
+        return true;
+      default:;
+        // Ignore unrecognized options since they might be consumed by
+        // other utils
+    }
+  }
+
+  return true;
+}
+
+void SleepFastForward::OnClock(unsigned long sim_time) {
+  if (!enabled_) {
+    return;
+  }
+
+  svSetScope(svGetScopeFromName(scope_.c_str()));
+  unsigned long long skippable = sleep_skippable_cycles();
+  if (!skippable) {
+    return;
+  }
+
+  unsigned long skipped = simctrl_.SkipCycles(skippable);
+  if (skipped) {
+    svSetScope(svGetScopeFromName(timer_scope_.c_str()));
+    timer_skip_cycles(skipped);
+  }
+}
+
+unsigned long SleepFastForward::NextWakeupCycle(unsigned long cycle) {
+  return enabled_ ? cycle + kCheckPeriod : kNoWakeup;
+}
@@ -0,0 +1,48 @@
+// Copyright lowRISC contributors.
+// Licensed under the Apache License, Version 2.0, see LICENSE for details.
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef SLEEP_FAST_FORWARD_H_
+#define SLEEP_FAST_FORWARD_H_
+
+#include <string>
+
+#include "sim_ctrl_extension.h"
+
+class VerilatorSimCtrl;
+
+/**
+ * Skip the cycles in which the core sleeps until the next timer interrupt
+ *
+ * Firmware waiting for the timer (e.g. in a wfi loop) otherwise spends most of
+ * the simulation time clocking an idle system. With --fast-forward-sleep the
+ * extension checks regularly whether the core sleeps with the timer interrupt
+ * as its only possible wake-up source and, if so, advances mtime and the
+ * simulation time to just before the interrupt.
+ *
+ * Skipped cycles are not counted by the core's performance counters
+ * (e.g. mcycle), and peripherals don't see them.
+ */
+class SleepFastForward : public SimCtrlExtension {
+ public:
+  /**
+   * @param simctrl Simulation controller to skip cycles in
+   * @param scope DPI scope of the module exporting sleep_skippable_cycles()
+   * @param timer_scope DPI scope of the timer exporting timer_skip_cycles()
+   */
+  SleepFastForward(VerilatorSimCtrl &simctrl, const std::string &scope,
+                   const std::string &timer_scope);
+
+  // Declared in SimCtrlExtension
+  bool ParseCLIArguments(int argc, char **argv, bool &exit_app) override;
+  void OnClock(unsigned long sim_time) override;
+  unsigned long NextWakeupCycle(unsigned long cycle) override;
+
+ private:
+  VerilatorSimCtrl &simctrl_;
+  std::string scope_;
+  std::string timer_scope_;
+  bool enabled_;
+};
+
+#endif  // SLEEP_FAST_FORWARD_H_
@@ -0,0 +1,159 @@
+// Copyright lowRISC contributors.
+// Licensed under the Apache License, Version 2.0, see LICENSE for details.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "stats_stream.h"
+
+#include <cstdlib>
+#include <getopt.h>
+#include <iostream>
+#include <svdpi.h>
+#include <unistd.h>
+
+#include "verilator_sim_ctrl.h"
+
+// DPI export, defined in ibex_demo_system.sv
+extern "C" {
+extern unsigned long long mhpmcounter_get(int index);
+}
+
+// Index of the instructions retired counter (minstret)
+static const int kInstretCounter = 2;
+
+// Get the resident set size of this process in KiB, 0 if unknown
+static unsigned long get_rss_kib() {
+  std::ifstream statm("/proc/self/statm");
+  unsigned long size_pages, rss_pages;
+  if (!(statm >> size_pages >> rss_pages)) {
+    return 0;
+  }
+  return rss_pages * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+StatsStream::StatsStream(VerilatorSimCtrl &simctrl, const std::string &scope)
+    : simctrl_(simctrl),
+      scope_(scope),
+      interval_(0),
+      started_(false),
+      start_cycle_(0),
+      last_cycle_(0) {}
+
+bool StatsStream::ParseCLIArguments(int argc, char **argv, bool &exit_app) {
+  const struct option long_options[] = {
+      {"stats-interval", required_argument, nullptr, 'I'},
+      {"stats-file", required_argument, nullptr, 'O'},
+      {"help", no_argument, nullptr, 'h'},
+      {nullptr, no_argument, nullptr, 0}};
+
+  // Reset the command parsing index in-case other utils have already parsed
+  // some arguments
+  optind = 1;
+  while (1) {
+    int c = getopt_long(argc, argv, "-:h", long_options, nullptr);
+    if (c == -1) {
+      break;
+    }
+
+    // Disable error reporting by getopt
+    opterr = 0;
+
+    switch (c) {
+      case 'I': {
+        char *txt_end;
+        interval_ = strtoul(optarg, &txt_end, 0);
+        if (*txt_end || !interval_) {
+          std::cerr << "ERROR: --stats-interval must be a positive number of "
+                       "cycles. Got: `"
+                    << optarg << "'." << std::endl;
+          return false;
+        }
+        break;
+      }
+      case 'O':
+        path_ = optarg;
+        break;
+      case 'h':
+        std::cout << "--stats-interval=CYCLES\n"
+                     "--stats-file=PATH\n"
+                     "  Append simulation statistics as JSON lines to PATH "
+                     "every CYCLES\n"
+                     "  cycles\n\n";
+        return true;
+      case ':':  // missing argument
+        std::cerr << "ERROR: Missing argument." << std::endl << std::endl;
+        return false;
+      default:;
+        // Ignore unrecognized options since they might be consumed by
+        // other utils
+    }
+  }
+
+  if (interval_ && path_.empty()) {
+    std::cerr << "ERROR: --stats-interval requires --stats-file." << std::endl;
+    return false;
+  }
+  if (!path_.empty()) {
+    if (!interval_) {
+      std::cerr << "ERROR: --stats-file requires --stats-interval."
+                << std::endl;
+      return false;
+    }
+    file_.open(path_, std::ios::app);
+    if (!file_) {
+      std::cerr << "ERROR: Could not open stats file `" << path_ << "'."
+                << std::endl;
+      return false;
+    }
+  }
+
+  return true;
+}
+
+void StatsStream::OnClock(unsigned long sim_time) {
+  if (!interval_) {
+    return;
+  }
+
+  unsigned long cycle = sim_time / 2;
+  if (!started_) {
+    start_time_ = last_time_ = std::chrono::steady_clock::now();
+    start_cycle_ = last_cycle_ = cycle;
+    started_ = true;
+    return;
+  }
+
+  WriteLine(cycle);
+}
+
+unsigned long StatsStream::NextWakeupCycle(unsigned long cycle) {
+  return interval_ ? cycle + interval_ : kNoWakeup;
+}
+
+void StatsStream::PostExec() {
+  if (started_) {
+    WriteLine(simctrl_.GetTime() / 2);
+  }
+  // Start over if the simulation runs again, e.g. in sim server mode
+  started_ = false;
+}
+
+void StatsStream::WriteLine(unsigned long cycle) {
+  auto now = std::chrono::steady_clock::now();
+  double wallclock_s =
+      std::chrono::duration<double>(now - start_time_).count();
+  double interval_s = std::chrono::duration<double>(now - last_time_).count();
+
+  svSetScope(svGetScopeFromName(scope_.c_str()));
+  unsigned long long instret = mhpmcounter_get(kInstretCounter);
+
+  file_ << "{\"cycles\": " << cycle << ", \"wallclock_s\": " << wallclock_s
+        << ", \"cycles_per_s\": "
+        << (interval_s > 0 ? (cycle - last_cycle_) / interval_s : 0)
+        << ", \"avg_cycles_per_s\": "
+        << (wallclock_s > 0 ? (cycle - start_cycle_) / wallclock_s : 0)
+        << ", \"instret\": " << instret << ", \"rss_kib\": " << get_rss_kib()
+        << "}" << std::endl;
+
+  last_time_ = now;
+  last_cycle_ = cycle;
+}
@@ -0,0 +1,58 @@
+// Copyright lowRISC contributors.
+// Licensed under the Apache License, Version 2.0, see LICENSE for details.
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef STATS_STREAM_H_
+#define STATS_STREAM_H_
+
+#include <chrono>
+#include <fstream>
+#include <string>
+
+#include "sim_ctrl_extension.h"
+
+class VerilatorSimCtrl;
+
+/**
+ * Periodically append simulation statistics to a file while simulating
+ *
+ * With --stats-interval=CYCLES and --stats-file=PATH, every CYCLES cycles and
+ * at the end of the simulation one line of JSON is appended to PATH:
+ *
+ * {"cycles": 2000000, "wallclock_s": 0.61, "cycles_per_s": 3.3e+06,
+ *  "avg_cycles_per_s": 3.2e+06, "instret": 1200000, "rss_kib": 21340}
+ *
+ * cycles_per_s is the simulation speed since the previous line, instret the
+ * number of instructions retired by the core and rss_kib the resident memory
+ * of the simulator process.
+ */
+class StatsStream : public SimCtrlExtension {
+ public:
+  /**
+   * @param simctrl Simulation controller to get the simulation time from
+   * @param scope DPI scope of the module exporting mhpmcounter_get()
+   */
+  StatsStream(VerilatorSimCtrl &simctrl, const std::string &scope);
+
+  // Declared in SimCtrlExtension
+  bool ParseCLIArguments(int argc, char **argv, bool &exit_app) override;
+  void OnClock(unsigned long sim_time) override;
+  unsigned long NextWakeupCycle(unsigned long cycle) override;
+  void PostExec() override;
+
+ private:
+  VerilatorSimCtrl &simctrl_;
+  std::string scope_;
+  unsigned long interval_;
+  std::string path_;
+  std::ofstream file_;
+  bool started_;
+  std::chrono::steady_clock::time_point start_time_;
+  unsigned long start_cycle_;
+  std::chrono::steady_clock::time_point last_time_;
+  unsigned long last_cycle_;
+
+  void WriteLine(unsigned long cycle);
+};
+
+#endif  // STATS_STREAM_H_
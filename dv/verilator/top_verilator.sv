@@ -9,6 +9,7 @@ module top_verilator (input logic clk_i, rst_ni);
   localparam BaudRate       = 115_200;
 
   logic uart_sys_rx, uart_sys_tx;
+  logic uartdpi_tx;
 
   // Instantiating the Ibex Demo System.
   ibex_demo_system #(
@@ -51,7 +52,91 @@ module top_verilator (input logic clk_i, rst_ni);
     .clk_i,
     .rst_ni,
     .active (1'b1       ),
-    .tx_o   (uart_sys_rx),
+    .tx_o   (uartdpi_tx ),
     .rx_i   (uart_sys_tx)
   );
+
+  // UART input read from a file, see top_verilator_start_job(). While a
+  // character from the file is sent, it replaces the output of the virtual
+  // UART.
+  localparam int CyclesPerSymbol = ClockFrequency / BaudRate;
+
+  integer     uart_in_fd;
+  logic       uart_in_tx;
+  logic       uart_in_active;
+  logic [9:0] uart_in_symbol;
+  int         uart_in_count;
+  int         uart_in_cyc_count;
+
+  initial uart_in_fd = 0;
+
+  always_ff @(negedge clk_i or negedge rst_ni) begin
+    if (!rst_ni) begin
+      uart_in_tx     <= 1'b1;
+      uart_in_active <= 1'b0;
+    end else if (!uart_in_active) begin
+      uart_in_tx <= 1'b1;
+      if (uart_in_fd != 0) begin
+        automatic int c = $fgetc(uart_in_fd);
+        if (c >= 0) begin
+          uart_in_symbol    <= {1'b1, c[7:0], 1'b0};
+          uart_in_active    <= 1'b1;
+          uart_in_count     <= 0;
+          uart_in_cyc_count <= 0;
+        end
+      end
+    end else begin
+      uart_in_cyc_count <= uart_in_cyc_count + 1;
+      uart_in_tx        <= uart_in_symbol[uart_in_count];
+      if (uart_in_cyc_count == CyclesPerSymbol - 1) begin
+        uart_in_cyc_count <= 0;
+        if (uart_in_count == 9) begin
+          uart_in_active <= 1'b0;
+        end else begin
+          uart_in_count <= uart_in_count + 1;
+        end
+      end
+    end
+  end
+
+  assign uart_sys_rx = uart_in_active ? uart_in_tx : uartdpi_tx;
+
+  // A simulation checkpoint restores the complete model state, including the
+  // uartdpi context and the simulator_ctrl log file descriptor. Both are only
+  // valid in the process that saved the checkpoint, so reopen them.
+  export "DPI-C" function top_verilator_reopen_handles;
+
+  function automatic void top_verilator_reopen_handles();
+    u_uartdpi.initialize();
+    u_ibex_demo_system.u_simulator_ctrl.log_fd =
+        $fopen(u_ibex_demo_system.u_simulator_ctrl.log_name, "a");
+  endfunction
+
+  // Each job of the sim server (see DemoSystem) runs the model again after the
+  // final blocks of the previous job closed the UART and the log file. Reopen
+  // them, writing the UART output to uart_log, and send the contents of the
+  // file uart_input (if not empty) to the demo system's UART.
+  import "DPI-C" function void uartdpi_close(input chandle ctx);
+
+  export "DPI-C" function top_verilator_start_job;
+
+  function automatic void top_verilator_start_job(input string uart_log,
+                                                  input string uart_input);
+    if (u_uartdpi.ctx != null) begin
+      uartdpi_close(u_uartdpi.ctx);
+    end
+    u_uartdpi.log_file_path = uart_log;
+    u_uartdpi.initialize();
+
+    if (u_ibex_demo_system.u_simulator_ctrl.log_fd != 0) begin
+      $fclose(u_ibex_demo_system.u_simulator_ctrl.log_fd);
+    end
+    u_ibex_demo_system.u_simulator_ctrl.log_fd =
+        $fopen(u_ibex_demo_system.u_simulator_ctrl.log_name, "a");
+
+    if (uart_in_fd != 0) begin
+      $fclose(uart_in_fd);
+    end
+    uart_in_fd = uart_input.len() != 0 ? $fopen(uart_input, "r") : 0;
+  endfunction
 endmodule
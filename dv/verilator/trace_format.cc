@@ -0,0 +1,673 @@
+// Copyright lowRISC contributors.
+// Licensed under the Apache License, Version 2.0, see LICENSE for details.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "trace_format.h"
+
+#include <cstdarg>
+#include <cstdio>
+
+const char kTraceHeader[] =
+    "Time\tCycle\tPC\tInsn\tDecoded instruction\tRegister and memory "
+    "contents\n";
+
+namespace {
+
+// Data items accessed by an instruction
+const unsigned kRs1 = 1 << 0;
+const unsigned kRs2 = 1 << 1;
+const unsigned kRs3 = 1 << 2;
+const unsigned kRd = 1 << 3;
+const unsigned kMem = 1 << 4;
+
+// Formats of the decode_*() functions of ibex_tracer.sv
+enum DecodeKind {
+  kMnemonic,
+  kR,
+  kR1,
+  kRCmixCmov,
+  kRFunnelShift,
+  kI,
+  kIShift,
+  kIFunnelShift,
+  kIJalr,
+  kU,
+  kJ,
+  kB,
+  kCsr,
+  kLoad,
+  kStore,
+  kFence,
+  kCAddi4spn,
+  kCLoad,
+  kCStore,
+  kCAddi,
+  kCJ,
+  kCLi,
+  kCLui,
+  kCShift,
+  kCB,
+  kCS,
+  kCSlli,
+};
+
+struct Pattern {
+  uint32_t mask;
+  uint32_t match;
+  DecodeKind kind;
+  const char *mnemonic;
+};
+
+// The INSN_* patterns of ibex_tracer_pkg.sv in the order of the case
+// statements of ibex_tracer.sv, the first match decides. The pseudo
+// instructions of grevi, gorci, shfli and unshfli come before them.
+const Pattern kPatterns32[] = {
+    {0x0000007f, 0x00000037, kU, "lui"},
+    {0x0000007f, 0x00000017, kU, "auipc"},
+    {0x0000007f, 0x0000006f, kJ, "jal"},
+    {0x0000707f, 0x00000067, kIJalr, "jalr"},
+    {0x0000707f, 0x00000063, kB, "beq"},
+    {0x0000707f, 0x00001063, kB, "bne"},
+    {0x0000707f, 0x00004063, kB, "blt"},
+    {0x0000707f, 0x00005063, kB, "bge"},
+    {0x0000707f, 0x00006063, kB, "bltu"},
+    {0x0000707f, 0x00007063, kB, "bgeu"},
+    {0x0000707f, 0x00000013, kI, "addi"},
+    {0x0000707f, 0x00002013, kI, "slti"},
+    {0x0000707f, 0x00003013, kI, "sltiu"},
+    {0x0000707f, 0x00004013, kI, "xori"},
+    {0x0000707f, 0x00006013, kI, "ori"},
+    {0x0000707f, 0x00007013, kI, "andi"},
+    {0xfe00707f, 0x00001013, kIShift, "slli"},
+    {0xfe00707f, 0x00005013, kIShift, "srli"},
+    {0xfe00707f, 0x40005013, kIShift, "srai"},
+    {0xfe00707f, 0x00000033, kR, "add"},
+    {0xfe00707f, 0x40000033, kR, "sub"},
+    {0xfe00707f, 0x00001033, kR, "sll"},
+    {0xfe00707f, 0x00002033, kR, "slt"},
+    {0xfe00707f, 0x00003033, kR, "sltu"},
+    {0xfe00707f, 0x00004033, kR, "xor"},
+    {0xfe00707f, 0x00005033, kR, "srl"},
+    {0xfe00707f, 0x40005033, kR, "sra"},
+    {0xfe00707f, 0x00006033, kR, "or"},
+    {0xfe00707f, 0x00007033, kR, "and"},
+    {0x0000707f, 0x00001073, kCsr, "csrrw"},
+    {0x0000707f, 0x00002073, kCsr, "csrrs"},
+    {0x0000707f, 0x00003073, kCsr, "csrrc"},
+    {0x0000707f, 0x00005073, kCsr, "csrrwi"},
+    {0x0000707f, 0x00006073, kCsr, "csrrsi"},
+    {0x0000707f, 0x00007073, kCsr, "csrrci"},
+    {0xffffffff, 0x00000073, kMnemonic, "ecall"},
+    {0xffffffff, 0x00100073, kMnemonic, "ebreak"},
+    {0xffffffff, 0x30200073, kMnemonic, "mret"},
+    {0xffffffff, 0x7b200073, kMnemonic, "dret"},
+    {0xffffffff, 0x10500073, kMnemonic, "wfi"},
+    {0xfe00707f, 0x02000033, kR, "mul"},
+    {0xfe00707f, 0x02001033, kR, "mulh"},
+    {0xfe00707f, 0x02002033, kR, "mulhsu"},
+    {0xfe00707f, 0x02003033, kR, "mulhu"},
+    {0xfe00707f, 0x02004033, kR, "div"},
+    {0xfe00707f, 0x02005033, kR, "divu"},
+    {0xfe00707f, 0x02006033, kR, "rem"},
+    {0xfe00707f, 0x02007033, kR, "remu"},
+    {0x0000007f, 0x00000003, kLoad, nullptr},
+    {0x0000007f, 0x00000023, kStore, nullptr},
+    {0x0000707f, 0x0000000f, kFence, nullptr},
+    {0xffffffff, 0x0000100f, kMnemonic, "fence.i"},
+    {0xfe00707f, 0x20002033, kR, "sh1add"},
+    {0xfe00707f, 0x20004033, kR, "sh2add"},
+    {0xfe00707f, 0x20006033, kR, "sh3add"},
+    {0xfc00707f, 0x60005013, kIShift, "rori"},
+    {0xfe00707f, 0x60001033, kR, "rol"},
+    {0xfe00707f, 0x60005033, kR, "ror"},
+    {0xfe00707f, 0x0a004033, kR, "min"},
+    {0xfe00707f, 0x0a006033, kR, "max"},
+    {0xfe00707f, 0x0a005033, kR, "minu"},
+    {0xfe00707f, 0x0a007033, kR, "maxu"},
+    {0xfe00707f, 0x40004033, kR, "xnor"},
+    {0xfe00707f, 0x40006033, kR, "orn"},
+    {0xfe00707f, 0x40007033, kR, "andn"},
+    {0xfe00707f, 0x08004033, kR, "pack"},
+    {0xfe00707f, 0x08007033, kR, "packh"},
+    {0xfe00707f, 0x48004033, kR, "packu"},
+    {0xfff0707f, 0x60001013, kR1, "clz"},
+    {0xfff0707f, 0x60101013, kR1, "ctz"},
+    {0xfff0707f, 0x60201013, kR1, "cpop"},
+    {0xfff0707f, 0x60401013, kR1, "sext.b"},
+    {0xfff0707f, 0x60501013, kR1, "sext.h"},
+    {0xf800707f, 0x48001013, kIShift, "bclri"},
+    {0xf800707f, 0x28001013, kIShift, "bseti"},
+    {0xf800707f, 0x68001013, kIShift, "binvi"},
+    {0xfc00707f, 0x48005013, kIShift, "bexti"},
+    {0xfe00707f, 0x48001033, kR, "bclr"},
+    {0xfe00707f, 0x28001033, kR, "bset"},
+    {0xfe00707f, 0x68001033, kR, "binv"},
+    {0xfe00707f, 0x48005033, kR, "bext"},
+    {0xfe00707f, 0x48006033, kR, "bdecompress"},
+    {0xfe00707f, 0x08006033, kR, "bcompress"},
+    {0xfe00707f, 0x68005033, kR, "grev"},
+    {0xfdf0707f, 0x68105013, kR1, "rev.p"},
+    {0xfdf0707f, 0x68205013, kR1, "rev2.n"},
+    {0xfdf0707f, 0x68305013, kR1, "rev.n"},
+    {0xfdf0707f, 0x68405013, kR1, "rev4.b"},
+    {0xfdf0707f, 0x68605013, kR1, "rev2.b"},
+    {0xfdf0707f, 0x68705013, kR1, "rev.b"},
+    {0xfdf0707f, 0x68805013, kR1, "rev8.h"},
+    {0xfdf0707f, 0x68c05013, kR1, "rev4.h"},
+    {0xfdf0707f, 0x68e05013, kR1, "rev2.h"},
+    {0xfdf0707f, 0x68f05013, kR1, "rev.h"},
+    {0xfdf0707f, 0x69005013, kR1, "rev16"},
+    {0xfdf0707f, 0x69805013, kR1, "rev8"},
+    {0xfdf0707f, 0x69c05013, kR1, "rev4"},
+    {0xfdf0707f, 0x69e05013, kR1, "rev2"},
+    {0xfdf0707f, 0x69f05013, kR1, "rev"},
+    {0xfc00707f, 0x68005013, kI, "grevi"},
+    {0xfe00707f, 0x28005033, kR, "gorc"},
+    {0xfdf0707f, 0x28105013, kR1, "orc.p"},
+    {0xfdf0707f, 0x28205013, kR1, "orc2.n"},
+    {0xfdf0707f, 0x28305013, kR1, "orc.n"},
+    {0xfdf0707f, 0x28405013, kR1, "orc4.b"},
+    {0xfdf0707f, 0x28605013, kR1, "orc2.b"},
+    {0xfdf0707f, 0x28705013, kR1, "orc.b"},
+    {0xfdf0707f, 0x28805013, kR1, "orc8.h"},
+    {0xfdf0707f, 0x28c05013, kR1, "orc4.h"},
+    {0xfdf0707f, 0x28e05013, kR1, "orc2.h"},
+    {0xfdf0707f, 0x28f05013, kR1, "orc.h"},
+    {0xfdf0707f, 0x29005013, kR1, "orc16"},
+    {0xfdf0707f, 0x29805013, kR1, "orc8"},
+    {0xfdf0707f, 0x29c05013, kR1, "orc4"},
+    {0xfdf0707f, 0x29e05013, kR1, "orc2"},
+    {0xfdf0707f, 0x29f05013, kR1, "orc"},
+    {0xfc00707f, 0x28005013, kI, "gorci"},
+    {0xfe00707f, 0x08001033, kR, "shfl"},
+    {0xfcf0707f, 0x08101013, kR1, "zip.n"},
+    {0xfcf0707f, 0x08201013, kR1, "zip2.b"},
+    {0xfcf0707f, 0x08301013, kR1, "zip.b"},
+    {0xfcf0707f, 0x08401013, kR1, "zip4.h"},
+    {0xfcf0707f, 0x08601013, kR1, "zip2.h"},
+    {0xfcf0707f, 0x08701013, kR1, "zip.h"},
+    {0xfcf0707f, 0x08801013, kR1, "zip8"},
+    {0xfcf0707f, 0x08c01013, kR1, "zip4"},
+    {0xfcf0707f, 0x08e01013, kR1, "zip2"},
+    {0xfcf0707f, 0x08f01013, kR1, "zip"},
+    {0xfc00707f, 0x08001013, kI, "shfli"},
+    {0xfe00707f, 0x08005033, kR, "unshfl"},
+    {0xfcf0707f, 0x08105013, kR1, "unzip.n"},
+    {0xfcf0707f, 0x08205013, kR1, "unzip2.b"},
+    {0xfcf0707f, 0x08305013, kR1, "unzip.b"},
+    {0xfcf0707f, 0x08405013, kR1, "unzip4.h"},
+    {0xfcf0707f, 0x08605013, kR1, "unzip2.h"},
+    {0xfcf0707f, 0x08705013, kR1, "unzip.h"},
+    {0xfcf0707f, 0x08805013, kR1, "unzip8"},
+    {0xfcf0707f, 0x08c05013, kR1, "unzip4"},
+    {0xfcf0707f, 0x08e05013, kR1, "unzip2"},
+    {0xfcf0707f, 0x08f05013, kR1, "unzip"},
+    {0xfc00707f, 0x08005013, kI, "unshfli"},
+    {0xfe00707f, 0x28002033, kR, "xperm_n"},
+    {0xfe00707f, 0x28004033, kR, "xperm_b"},
+    {0xfe00707f, 0x28006033, kR, "xperm_h"},
+    {0xfe00707f, 0x20001033, kR, "slo"},
+    {0xfe00707f, 0x20005033, kR, "sro"},
+    {0xf800707f, 0x20001013, kIShift, "sloi"},
+    {0xfc00707f, 0x20005013, kIShift, "sroi"},
+    {0x0600707f, 0x06001033, kRCmixCmov, "cmix"},
+    {0x0600707f, 0x06005033, kRCmixCmov, "cmov"},
+    {0x0600707f, 0x04005033, kRFunnelShift, "fsr"},
+    {0x0600707f, 0x04001033, kRFunnelShift, "fsl"},
+    {0x0400707f, 0x04005013, kIFunnelShift, "fsri"},
+    {0xfe00707f, 0x48007033, kR, "bfp"},
+    {0xfe00707f, 0x0a001033, kR, "clmul"},
+    {0xfe00707f, 0x0a002033, kR, "clmulr"},
+    {0xfe00707f, 0x0a003033, kR, "clmulh"},
+    {0xfff0707f, 0x61001013, kR1, "crc32.b"},
+    {0xfff0707f, 0x61101013, kR1, "crc32.h"},
+    {0xfff0707f, 0x61201013, kR1, "crc32.w"},
+    {0xfff0707f, 0x61801013, kR1, "crc32c.b"},
+    {0xfff0707f, 0x61901013, kR1, "crc32c.h"},
+    {0xfff0707f, 0x61a01013, kR1, "crc32c.w"},
+};
+
+// Compressed instructions other than c.ebreak, c.jalr, c.add, c.jr and c.mv
+const Pattern kPatterns16[] = {
+    {0xe003, 0x0000, kCAddi4spn, "c.addi4spn"},
+    {0xe003, 0x4000, kCLoad, "c.lw"},
+    {0xe003, 0xc000, kCStore, "c.sw"},
+    {0xe003, 0x0001, kCAddi, "c.addi"},
+    {0xe003, 0x2001, kCJ, "c.jal"},
+    {0xe003, 0xa001, kCJ, "c.j"},
+    {0xe003, 0x4001, kCLi, "c.li"},
+    {0xe003, 0x6001, kCLui, nullptr},
+    {0xec03, 0x8001, kCShift, "c.srli"},
+    {0xec03, 0x8401, kCShift, "c.srai"},
+    {0xec03, 0x8801, kCB, "c.andi"},
+    {0xfc63, 0x8c01, kCS, "c.sub"},
+    {0xfc63, 0x8c21, kCS, "c.xor"},
+    {0xfc63, 0x8c41, kCS, "c.or"},
+    {0xfc63, 0x8c61, kCS, "c.and"},
+    {0xe003, 0xc001, kCB, "c.beqz"},
+    {0xe003, 0xe001, kCB, "c.bnez"},
+    {0xe003, 0x0002, kCSlli, "c.slli"},
+    {0xe003, 0x4002, kCLoad, "c.lwsp"},
+    {0xe003, 0xc002, kCStore, "c.swsp"},
+};
+
+uint32_t Bits(uint32_t value, int hi, int lo) {
+  return (value >> lo) & ((1ull << (hi - lo + 1)) - 1);
+}
+
+int32_t Signed(uint32_t value, int width) {
+  return (int32_t)(value << (32 - width)) >> (32 - width);
+}
+
+std::string Format(const char *fmt, ...) {
+  char buf[128];
+  va_list args;
+  va_start(args, fmt);
+  vsnprintf(buf, sizeof(buf), fmt, args);
+  va_end(args);
+  return buf;
+}
+
+std::string RegAddrToStr(uint32_t addr) {
+  return Format(addr < 10 ? " x%u" : "x%u", addr);
+}
+
+std::string GetCsrName(uint32_t csr_addr) {
+  switch (csr_addr) {
+    case 0x000: return "ustatus";
+    case 0x004: return "uie";
+    case 0x005: return "utvec";
+    case 0x040: return "uscratch";
+    case 0x041: return "uepc";
+    case 0x042: return "ucause";
+    case 0x043: return "utval";
+    case 0x044: return "uip";
+    case 0x001: return "fflags";
+    case 0x002: return "frm";
+    case 0x003: return "fcsr";
+    case 0xc00: return "cycle";
+    case 0xc01: return "time";
+    case 0xc02: return "instret";
+    case 0xc80: return "cycleh";
+    case 0xc81: return "timeh";
+    case 0xc82: return "instreth";
+    case 0x100: return "sstatus";
+    case 0x102: return "sedeleg";
+    case 0x103: return "sideleg";
+    case 0x104: return "sie";
+    case 0x105: return "stvec";
+    case 0x106: return "scounteren";
+    case 0x140: return "sscratch";
+    case 0x141: return "sepc";
+    case 0x142: return "scause";
+    case 0x143: return "stval";
+    case 0x144: return "sip";
+    case 0x180: return "satp";
+    case 0xf11: return "mvendorid";
+    case 0xf12: return "marchid";
+    case 0xf13: return "mimpid";
+    case 0xf14: return "mhartid";
+    case 0x300: return "mstatus";
+    case 0x301: return "misa";
+    case 0x302: return "medeleg";
+    case 0x303: return "mideleg";
+    case 0x304: return "mie";
+    case 0x305: return "mtvec";
+    case 0x306: return "mcounteren";
+    case 0x340: return "mscratch";
+    case 0x341: return "mepc";
+    case 0x342: return "mcause";
+    case 0x343: return "mtval";
+    case 0x344: return "mip";
+    case 0xb00: return "mcycle";
+    case 0xb02: return "minstret";
+    case 0xb80: return "mcycleh";
+    case 0xb82: return "minstreth";
+    case 0x7a0: return "tselect";
+    case 0x7a1: return "tdata1";
+    case 0x7a2: return "tdata2";
+    case 0x7a3: return "tdata3";
+    case 0x7b0: return "dcsr";
+    case 0x7b1: return "dpc";
+    case 0x7b2: return "dscratch";
+    case 0x200: return "hstatus";
+    case 0x202: return "hedeleg";
+    case 0x203: return "hideleg";
+    case 0x204: return "hie";
+    case 0x205: return "htvec";
+    case 0x240: return "hscratch";
+    case 0x241: return "hepc";
+    case 0x242: return "hcause";
+    case 0x243: return "hbadaddr";
+    case 0x244: return "hip";
+    case 0x380: return "mbase";
+    case 0x381: return "mbound";
+    case 0x382: return "mibase";
+    case 0x383: return "mibound";
+    case 0x384: return "mdbase";
+    case 0x385: return "mdbound";
+    case 0x320: return "mcountinhibit";
+    default:;
+  }
+
+  // Numbered CSRs
+  uint32_t base = csr_addr & ~0x1fu;
+  uint32_t n = csr_addr & 0x1f;
+  if (n >= 3) {
+    switch (base) {
+      case 0xc00: return Format("hpmcounter%u", n);
+      case 0xc80: return Format("hpmcounter%uh", n);
+      case 0xb00: return Format("mhpmcounter%u", n);
+      case 0xb80: return Format("mhpmcounter%uh", n);
+      case 0x320: return Format("mhpmevent%u", n);
+      default:;
+    }
+  }
+  if (csr_addr >= 0x3a0 && csr_addr <= 0x3a3) {
+    return Format("pmpcfg%u", csr_addr - 0x3a0);
+  }
+  if (csr_addr >= 0x3b0 && csr_addr <= 0x3bf) {
+    return Format("pmpaddr%u", csr_addr - 0x3b0);
+  }
+  return Format("0x%03x", csr_addr);
+}
+
+std::string GetFenceDescription(uint32_t bits) {
+  std::string desc;
+  if (bits & 8) {
+    desc += "i";
+  }
+  if (bits & 4) {
+    desc += "o";
+  }
+  if (bits & 2) {
+    desc += "r";
+  }
+  if (bits & 1) {
+    desc += "w";
+  }
+  return desc;
+}
+
+// Like the decode_*() functions of ibex_tracer.sv, set the decoded string and
+// return the data accessed by the instruction
+unsigned Decode(const RetiredInstr &r, DecodeKind kind, const char *mnemonic,
+                std::string &decoded) {
+  uint32_t insn = r.insn;
+  switch (kind) {
+    case kMnemonic:
+      decoded = mnemonic;
+      return 0;
+    case kR:
+      decoded = Format("%s\tx%u,x%u,x%u", mnemonic, r.rd_addr, r.rs1_addr,
+                       r.rs2_addr);
+      return kRs1 | kRs2 | kRd;
+    case kR1:
+      decoded = Format("%s\tx%u,x%u", mnemonic, r.rd_addr, r.rs1_addr);
+      return kRs1 | kRd;
+    case kRCmixCmov:
+      decoded = Format("%s\tx%u,x%u,x%u,x%u", mnemonic, r.rd_addr, r.rs2_addr,
+                       r.rs1_addr, r.rs3_addr);
+      return kRs1 | kRs2 | kRs3 | kRd;
+    case kRFunnelShift:
+      decoded = Format("%s\tx%u,x%u,x%u,x%u", mnemonic, r.rd_addr, r.rs1_addr,
+                       r.rs3_addr, r.rs2_addr);
+      return kRs1 | kRs2 | kRs3 | kRd;
+    case kI:
+      decoded = Format("%s\tx%u,x%u,%d", mnemonic, r.rd_addr, r.rs1_addr,
+                       Signed(Bits(insn, 31, 20), 12));
+      return kRs1 | kRd;
+    case kIShift:
+      decoded = Format("%s\tx%u,x%u,0x%x", mnemonic, r.rd_addr, r.rs1_addr,
+                       Bits(insn, 24, 20));
+      return kRs1 | kRd;
+    case kIFunnelShift:
+      decoded = Format("%s\tx%u,x%u,x%u,0x%x", mnemonic, r.rd_addr, r.rs1_addr,
+                       r.rs3_addr, Bits(insn, 25, 20));
+      return kRs1 | kRs3 | kRd;
+    case kIJalr:
+      decoded = Format("%s\tx%u,%d(x%u)", mnemonic, r.rd_addr,
+                       Signed(Bits(insn, 31, 20), 12), r.rs1_addr);
+      return kRs1 | kRd;
+    case kU:
+      decoded =
+          Format("%s\tx%u,0x%x", mnemonic, r.rd_addr, Bits(insn, 31, 12));
+      return kRd;
+    case kJ:
+      decoded = Format("%s\tx%u,%x", mnemonic, r.rd_addr, r.pc_wdata);
+      return kRd;
+    case kB: {
+      // We cannot use pc_wdata for conditional jumps.
+      uint32_t imm = Bits(insn, 31, 31) << 12 | Bits(insn, 7, 7) << 11 |
+                     Bits(insn, 30, 25) << 5 | Bits(insn, 11, 8) << 1;
+      decoded = Format("%s\tx%u,x%u,%x", mnemonic, r.rs1_addr, r.rs2_addr,
+                       r.pc_rdata + Signed(imm, 13));
+      return kRs1 | kRs2;
+    }
+    case kCsr: {
+      std::string csr_name = GetCsrName(Bits(insn, 31, 20));
+      if (!Bits(insn, 14, 14)) {
+        decoded = Format("%s\tx%u,%s,x%u", mnemonic, r.rd_addr,
+                         csr_name.c_str(), r.rs1_addr);
+        return kRd | kRs1;
+      }
+      decoded = Format("%s\tx%u,%s,%u", mnemonic, r.rd_addr, csr_name.c_str(),
+                       Bits(insn, 19, 15));
+      return kRd;
+    }
+    case kLoad: {
+      static const char *const kLoads[] = {"lb",  "lh",  "lw",      nullptr,
+                                           "lbu", "lhu", nullptr, nullptr};
+      mnemonic = kLoads[Bits(insn, 14, 12)];
+      if (!mnemonic) {
+        decoded = "INVALID";
+        return 0;
+      }
+      decoded = Format("%s\tx%u,%d(x%u)", mnemonic, r.rd_addr,
+                       Signed(Bits(insn, 31, 20), 12), r.rs1_addr);
+      return kRd | kRs1 | kMem;
+    }
+    case kStore: {
+      static const char *const kStores[] = {"sb", "sh", "sw", nullptr};
+      mnemonic = kStores[Bits(insn, 13, 12)];
+      if (!mnemonic || Bits(insn, 14, 14)) {
+        decoded = "INVALID";
+        return 0;
+      }
+      decoded = Format("%s\tx%u,%d(x%u)", mnemonic, r.rs2_addr,
+                       Signed(Bits(insn, 31, 25) << 5 | Bits(insn, 11, 7), 12),
+                       r.rs1_addr);
+      return kRs1 | kRs2 | kMem;
+    }
+    case kFence:
+      decoded = "fence\t" + GetFenceDescription(Bits(insn, 27, 24)) + "," +
+                GetFenceDescription(Bits(insn, 23, 20));
+      return 0;
+    case kCAddi4spn: {
+      if (Bits(insn, 12, 2) == 0) {
+        // Align with pseudo-mnemonic used by GNU binutils and LLVM's MC layer
+        decoded = "c.unimp";
+        return 0;
+      }
+      uint32_t nzuimm = Bits(insn, 10, 7) << 6 | Bits(insn, 12, 11) << 4 |
+                        Bits(insn, 5, 5) << 3 | Bits(insn, 6, 6) << 2;
+      decoded = Format("%s\tx%u,x2,%u", mnemonic, r.rd_addr, nzuimm);
+      return kRd;
+    }
+    case kCLoad: {
+      uint32_t imm;
+      if (Bits(insn, 1, 0) == 0) {
+        // C.LW
+        imm = Bits(insn, 5, 5) << 6 | Bits(insn, 12, 10) << 3 |
+              Bits(insn, 6, 6) << 2;
+      } else {
+        // C.LWSP
+        imm = Bits(insn, 3, 2) << 6 | Bits(insn, 12, 12) << 5 |
+              Bits(insn, 6, 4) << 2;
+      }
+      decoded =
+          Format("%s\tx%u,%u(x%u)", mnemonic, r.rd_addr, imm, r.rs1_addr);
+      return kRs1 | kRd | kMem;
+    }
+    case kCStore: {
+      uint32_t imm;
+      if (Bits(insn, 1, 0) == 0) {
+        // C.SW
+        imm = Bits(insn, 5, 5) << 6 | Bits(insn, 12, 10) << 3 |
+              Bits(insn, 6, 6) << 2;
+      } else {
+        // C.SWSP
+        imm = Bits(insn, 8, 7) << 6 | Bits(insn, 12, 9) << 2;
+      }
+      decoded =
+          Format("%s\tx%u,%u(x%u)", mnemonic, r.rs2_addr, imm, r.rs1_addr);
+      return kRs1 | kRs2 | kMem;
+    }
+    case kCAddi:
+    case kCLi:
+      decoded = Format("%s\tx%u,%d", mnemonic, r.rd_addr,
+                       Signed(Bits(insn, 12, 12) << 5 | Bits(insn, 6, 2), 6));
+      return kind == kCAddi ? kRs1 | kRd : kRd;
+    case kCJ:
+      decoded = Format("%s\t%x", mnemonic, r.pc_wdata);
+      // Only C.JAL writes a register
+      return Bits(insn, 15, 13) == 1 ? kRd : 0;
+    case kCLui:
+      // These two instructions share opcode
+      if (Bits(insn, 11, 7) == 2) {
+        uint32_t nzimm = Bits(insn, 12, 12) << 9 | Bits(insn, 4, 3) << 7 |
+                         Bits(insn, 5, 5) << 6 | Bits(insn, 2, 2) << 5 |
+                         Bits(insn, 6, 6) << 4;
+        decoded =
+            Format("c.addi16sp\tx%u,%d", r.rd_addr, Signed(nzimm, 10));
+        return kRs1 | kRd;
+      }
+      decoded = Format(
+          "c.lui\tx%u,0x%x", r.rd_addr,
+          Signed(Bits(insn, 12, 12) << 5 | Bits(insn, 6, 2), 6) & 0xfffff);
+      return kRd;
+    case kCShift:
+      decoded = Format("%s\tx%u,0x%x", mnemonic, r.rs1_addr,
+                       Bits(insn, 12, 12) << 5 | Bits(insn, 6, 2));
+      return kRs1 | kRd;
+    case kCB: {
+      uint32_t funct3 = Bits(insn, 15, 13);
+      if (funct3 == 6 || funct3 == 7) {
+        // C.BNEZ and C.BEQZ
+        uint32_t imm = Bits(insn, 12, 12) << 7 | Bits(insn, 6, 5) << 5 |
+                       Bits(insn, 2, 2) << 4 | Bits(insn, 11, 10) << 2 |
+                       Bits(insn, 4, 3);
+        decoded = Format("%s\tx%u,%x", mnemonic, r.rs1_addr,
+                         r.pc_rdata + Signed(imm << 1, 9));
+        return kRs1;
+      }
+      if (funct3 == 4) {
+        // C.ANDI
+        decoded = Format("%s\tx%u,%d", mnemonic, r.rd_addr,
+                         Signed(Bits(insn, 12, 12) << 5 | Bits(insn, 6, 2), 6));
+        return kRs1 | kRd;
+      }
+      decoded = Format("%s\tx%u,0x%x", mnemonic, r.rs1_addr,
+                       (Bits(insn, 12, 12) << 7 | Bits(insn, 6, 2) << 2) & 0xff);
+      return kRs1;
+    }
+    case kCS:
+      decoded = Format("%s\tx%u,x%u", mnemonic, r.rd_addr, r.rs2_addr);
+      return kRs1 | kRs2 | kRd;
+    case kCSlli:
+      decoded = Format("%s\tx%u,0x%x", mnemonic, r.rd_addr,
+                       Bits(insn, 12, 12) << 5 | Bits(insn, 6, 2));
+      return kRs1 | kRd;
+  }
+  return 0;
+}
+
+// c.ebreak, c.jalr, c.add, c.jr and c.mv, decoded separately by ibex_tracer.sv
+unsigned DecodeCr(const RetiredInstr &r, std::string &decoded) {
+  uint32_t insn = r.insn;
+  const char *mnemonic;
+  if (Bits(insn, 12, 12)) {
+    if (Bits(insn, 11, 2) == 0) {
+      decoded = "c.ebreak";
+      return 0;
+    }
+    mnemonic = Bits(insn, 6, 2) == 0 ? "c.jalr" : "c.add";
+  } else {
+    mnemonic = Bits(insn, 6, 2) == 0 ? "c.jr" : "c.mv";
+  }
+
+  if (r.rs2_addr == 0) {
+    decoded = Format("%s\tx%u", mnemonic, r.rs1_addr);
+    // C.JALR writes the link register, C.JR doesn't
+    return Bits(insn, 12, 12) ? kRs1 | kRd : kRs1;
+  }
+  decoded = Format("%s\tx%u,x%u", mnemonic, r.rd_addr, r.rs2_addr);
+  return kRs1 | kRs2 | kRd;
+}
+
+template <size_t N>
+unsigned DecodeTable(const RetiredInstr &r, uint32_t insn,
+                     const Pattern (&patterns)[N], std::string &decoded) {
+  for (const Pattern &pattern : patterns) {
+    if ((insn & pattern.mask) == pattern.match) {
+      return Decode(r, pattern.kind, pattern.mnemonic, decoded);
+    }
+  }
+  decoded = "INVALID";
+  return 0;
+}
+
+}  // namespace
+
+std::string FormatTraceLine(const RetiredInstr &instr) {
+  std::string decoded;
+  unsigned data_accessed;
+  std::string insn_str;
+
+  // Write compressed instructions as four hex digits (16 bit word), and
+  // uncompressed ones as 8 hex digits (32 bit words).
+  if (Bits(instr.insn, 1, 0) != 3) {
+    insn_str = Format("%04x", Bits(instr.insn, 15, 0));
+    if (Bits(instr.insn, 15, 13) == 4 && Bits(instr.insn, 1, 0) == 2) {
+      data_accessed = DecodeCr(instr, decoded);
+    } else {
+      data_accessed =
+          DecodeTable(instr, Bits(instr.insn, 15, 0), kPatterns16, decoded);
+    }
+  } else {
+    insn_str = Format("%08x", instr.insn);
+    data_accessed = DecodeTable(instr, instr.insn, kPatterns32, decoded);
+  }
+
+  std::string line = Format("%15llu\t%10u\t%08x\t", (unsigned long long)instr.time,
+                            instr.cycle, instr.pc_rdata) +
+                     insn_str + "\t" + decoded + "\t";
+
+  if (data_accessed & kRs1) {
+    line += Format(" %s:0x%08x", RegAddrToStr(instr.rs1_addr).c_str(),
+                   instr.rs1_rdata);
+  }
+  if (data_accessed & kRs2) {
+    line += Format(" %s:0x%08x", RegAddrToStr(instr.rs2_addr).c_str(),
+                   instr.rs2_rdata);
+  }
+  if (data_accessed & kRs3) {
+    line += Format(" %s:0x%08x", RegAddrToStr(instr.rs3_addr).c_str(),
+                   instr.rs3_rdata);
+  }
+  if (data_accessed & kRd) {
+    line += Format(" %s=0x%08x", RegAddrToStr(instr.rd_addr).c_str(),
+                   instr.rd_wdata);
+  }
+  if (data_accessed & kMem) {
+    line += Format(" PA:0x%08x", instr.mem_addr);
+    if (instr.mem_wmask) {
+      line += Format(" store:0x%08x", instr.mem_wdata);
+    }
+    if (instr.mem_rmask) {
+      line += Format(" load:0x%08x", instr.mem_rdata);
+    }
+  }
+
+  return line + "\n";
+}
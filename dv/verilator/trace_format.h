@@ -0,0 +1,48 @@
+// Copyright lowRISC contributors.
+// Licensed under the Apache License, Version 2.0, see LICENSE for details.
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef TRACE_FORMAT_H_
+#define TRACE_FORMAT_H_
+
+#include <cstdint>
+#include <string>
+
+/**
+ * RVFI data of a retired instruction
+ */
+struct RetiredInstr {
+  uint64_t time;
+  uint32_t cycle;
+  uint32_t pc_rdata;
+  uint32_t pc_wdata;
+  uint32_t insn;
+  uint32_t rs1_rdata;
+  uint32_t rs2_rdata;
+  uint32_t rs3_rdata;
+  uint32_t rd_wdata;
+  uint32_t mem_addr;
+  uint32_t mem_rdata;
+  uint32_t mem_wdata;
+  uint8_t rs1_addr;
+  uint8_t rs2_addr;
+  uint8_t rs3_addr;
+  uint8_t rd_addr;
+  uint8_t mem_rmask;
+  uint8_t mem_wmask;
+};
+
+/**
+ * Header line of the instruction trace written by ibex_tracer
+ */
+extern const char kTraceHeader[];
+
+/**
+ * Format a retired instruction like a line of ibex_tracer's trace
+ *
+ * The decoding follows vendor/lowrisc_ibex/rtl/ibex_tracer.sv, so the line is
+ * the one the tracer would have written, including the newline.
+ */
+std::string FormatTraceLine(const RetiredInstr &instr);
+
+#endif  // TRACE_FORMAT_H_
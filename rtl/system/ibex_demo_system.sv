@@ -97,6 +97,7 @@ module ibex_demo_system #(
 
   // Interrupts.
   logic timer_irq;
+  logic core_sleep;
   logic uart_irq;
 
   // Host signals.
@@ -146,6 +147,28 @@ module ibex_demo_system #(
   logic ndmreset_req;
   logic dm_debug_req;
 
+`ifdef RVFI
+  // RISC-V Formal Interface of the core, used by the simulation to observe
+  // retired instructions, see flight_recorder_retire() below.
+  logic        rvfi_valid;
+  logic [31:0] rvfi_insn;
+  logic [ 4:0] rvfi_rs1_addr;
+  logic [ 4:0] rvfi_rs2_addr;
+  logic [ 4:0] rvfi_rs3_addr;
+  logic [31:0] rvfi_rs1_rdata;
+  logic [31:0] rvfi_rs2_rdata;
+  logic [31:0] rvfi_rs3_rdata;
+  logic [ 4:0] rvfi_rd_addr;
+  logic [31:0] rvfi_rd_wdata;
+  logic [31:0] rvfi_pc_rdata;
+  logic [31:0] rvfi_pc_wdata;
+  logic [31:0] rvfi_mem_addr;
+  logic [ 3:0] rvfi_mem_rmask;
+  logic [ 3:0] rvfi_mem_wmask;
+  logic [31:0] rvfi_mem_rdata;
+  logic [31:0] rvfi_mem_wdata;
+`endif
+
   // Device address mapping.
   logic [31:0] cfg_device_addr_base [NrDevices];
   logic [31:0] cfg_device_addr_mask [NrDevices];
@@ -289,11 +312,49 @@ module ibex_demo_system #(
     .crash_dump_o       (),
     .double_fault_seen_o(),
 
+`ifdef RVFI
+    .rvfi_valid,
+    .rvfi_order               (),
+    .rvfi_insn,
+    .rvfi_trap                (),
+    .rvfi_halt                (),
+    .rvfi_intr                (),
+    .rvfi_mode                (),
+    .rvfi_ixl                 (),
+    .rvfi_rs1_addr,
+    .rvfi_rs2_addr,
+    .rvfi_rs3_addr,
+    .rvfi_rs1_rdata,
+    .rvfi_rs2_rdata,
+    .rvfi_rs3_rdata,
+    .rvfi_rd_addr,
+    .rvfi_rd_wdata,
+    .rvfi_pc_rdata,
+    .rvfi_pc_wdata,
+    .rvfi_mem_addr,
+    .rvfi_mem_rmask,
+    .rvfi_mem_wmask,
+    .rvfi_mem_rdata,
+    .rvfi_mem_wdata,
+    .rvfi_ext_pre_mip         (),
+    .rvfi_ext_post_mip        (),
+    .rvfi_ext_nmi             (),
+    .rvfi_ext_nmi_int         (),
+    .rvfi_ext_debug_req       (),
+    .rvfi_ext_debug_mode      (),
+    .rvfi_ext_rf_wr_suppress  (),
+    .rvfi_ext_mcycle          (),
+    .rvfi_ext_mhpmcounters    (),
+    .rvfi_ext_mhpmcountersh   (),
+    .rvfi_ext_ic_scr_key_valid(),
+    .rvfi_ext_irq_valid       (),
+`endif
+
     .fetch_enable_i        ('1),
     .alert_minor_o         (),
     .alert_major_internal_o(),
     .alert_major_bus_o     (),
-    .core_sleep_o          ()
+    .core_sleep_o          (core_sleep)
   );
 
   ram_2p #(
@@ -402,6 +463,10 @@ module ibex_demo_system #(
   );
 
   `ifdef VERILATOR
+    logic        perf_region_valid;
+    logic        perf_region_end;
+    logic [31:0] perf_region_id;
+
     simulator_ctrl #(
       .LogName ( "ibex_demo_system.log" )
     ) u_simulator_ctrl (
@@ -414,7 +479,11 @@ module ibex_demo_system #(
       .addr_i  (device_addr[SimCtrl]),
       .wdata_i (device_wdata[SimCtrl]),
       .rvalid_o(device_rvalid[SimCtrl]),
-      .rdata_o (device_rdata[SimCtrl])
+      .rdata_o (device_rdata[SimCtrl]),
+
+      .region_valid_o(perf_region_valid),
+      .region_end_o  (perf_region_end),
+      .region_id_o   (perf_region_id)
     );
   `endif
 
@@ -507,5 +576,362 @@ module ibex_demo_system #(
     function automatic longint unsigned mhpmcounter_get(int index);
       return u_top.u_ibex_core.cs_registers_i.mhpmcounter[index];
     endfunction
+
+    // Trace trigger on the PC of a retired instruction, armed by the
+    // simulation, see dv/verilator/pc_trace_trigger.cc.
+    import "DPI-C" function void pc_trace_trigger_hit();
+
+    export "DPI-C" function pc_trace_trigger_set;
+
+    bit          pc_trace_trigger_en;
+    logic [31:0] pc_trace_trigger_pc;
+
+    initial pc_trace_trigger_en = 1'b0;
+
+    function automatic void pc_trace_trigger_set(bit enable, int unsigned pc);
+      pc_trace_trigger_en = enable;
+      pc_trace_trigger_pc = pc;
+    endfunction
+
+    // As the core has no writeback stage, the instruction retiring is the one
+    // in the ID stage.
+    always @(posedge clk_sys_i) begin
+      if (pc_trace_trigger_en && u_top.u_ibex_core.perf_instr_ret_wb &&
+          (u_top.u_ibex_core.pc_id == pc_trace_trigger_pc)) begin
+        pc_trace_trigger_hit();
+      end
+    end
+
+    // PC of the instruction retired last, sampled by the simulation, see
+    // dv/verilator/pc_sampler.cc. The instruction retiring is the one in the
+    // ID stage.
+    export "DPI-C" function pc_sample_get;
+
+    logic [31:0] pc_sample_last_retired;
+
+    initial pc_sample_last_retired = '0;
+
+    // Like the state of the hooks below, cleared by the reset so that a job of
+    // the sim server doesn't see the state of the previous one
+    always @(posedge clk_sys_i) begin
+      if (!rst_sys_ni) begin
+        pc_sample_last_retired <= '0;
+      end else if (u_top.u_ibex_core.perf_instr_ret_wb) begin
+        pc_sample_last_retired <= u_top.u_ibex_core.pc_id;
+      end
+    end
+
+    function automatic int unsigned pc_sample_get();
+      return pc_sample_last_retired;
+    endfunction
+
+    // Begin and end of the measurement regions of the software, written to
+    // simulator_ctrl, see dv/verilator/perf_regions.cc. The simulation reads
+    // the performance counters through mhpmcounter_get(). The events go to the
+    // PerfRegions instance set with perf_regions_set().
+    import "DPI-C" context function void perf_region_event(chandle regions,
+                                                           bit region_end,
+                                                           int unsigned id);
+
+    export "DPI-C" function perf_regions_set;
+
+    chandle perf_regions_handle;
+
+    initial perf_regions_handle = null;
+
+    function automatic void perf_regions_set(chandle regions);
+      perf_regions_handle = regions;
+    endfunction
+
+    always @(posedge clk_sys_i) begin
+      if (rst_sys_ni && perf_region_valid && perf_regions_handle != null) begin
+        perf_region_event(perf_regions_handle, perf_region_end, perf_region_id);
+      end
+    end
+
+    // Data bus transactions for the bus monitor, see
+    // dv/verilator/bus_monitor.cc. Each granted request is reported with the
+    // cycles the host waited for the grant, each response with the cycles
+    // since the grant. Requests not decoded to any device have device index
+    // NrDevices. The transactions go to the BusMonitor instance set with
+    // bus_monitor_set().
+    import "DPI-C" function void bus_monitor_request(chandle monitor,
+      int host, int device, bit we, int unsigned addr, int unsigned wait_cycles);
+    import "DPI-C" function void bus_monitor_response(chandle monitor, int host,
+                                                      int unsigned cycles);
+
+    export "DPI-C" function bus_monitor_set;
+
+    bit          bus_monitor_en;
+    chandle      bus_monitor_handle;
+    int unsigned bus_monitor_wait [NrHosts];
+    int unsigned bus_monitor_resp [NrHosts];
+
+    initial begin
+      bus_monitor_en = 1'b0;
+      for (int h = 0; h < NrHosts; h++) begin
+        bus_monitor_wait[h] = 0;
+        bus_monitor_resp[h] = 0;
+      end
+    end
+
+    function automatic void bus_monitor_set(bit enable, chandle monitor);
+      bus_monitor_en     = enable;
+      bus_monitor_handle = monitor;
+    endfunction
+
+    function automatic int bus_monitor_device();
+      for (int d = 0; d < NrDevices; d++) begin
+        if (device_req[d]) begin
+          return d;
+        end
+      end
+      return NrDevices;
+    endfunction
+
+    always @(posedge clk_sys_i) begin
+      if (!rst_sys_ni) begin
+        for (int h = 0; h < NrHosts; h++) begin
+          bus_monitor_wait[h] <= 0;
+          bus_monitor_resp[h] <= 0;
+        end
+      end else if (bus_monitor_en) begin
+        for (int h = 0; h < NrHosts; h++) begin
+          if (bus_monitor_resp[h] != 0) begin
+            if (host_rvalid[h]) begin
+              bus_monitor_response(bus_monitor_handle, h, bus_monitor_resp[h]);
+              bus_monitor_resp[h] <= 0;
+            end else begin
+              bus_monitor_resp[h] <= bus_monitor_resp[h] + 1;
+            end
+          end
+          if (host_req[h] && host_gnt[h]) begin
+            bus_monitor_request(bus_monitor_handle, h, bus_monitor_device(), host_we[h],
+                                host_addr[h], bus_monitor_wait[h]);
+            bus_monitor_wait[h] <= 0;
+            bus_monitor_resp[h] <= 1;
+          end else if (host_req[h]) begin
+            bus_monitor_wait[h] <= bus_monitor_wait[h] + 1;
+          end
+        end
+      end
+    end
+
+    // Retired jumps and traps for the call profiler, see
+    // dv/verilator/call_profiler.cc. Each jump or trap is reported together
+    // with the PC of the next retired instruction (the target) and the
+    // performance counters at that point. As the core has no writeback stage,
+    // the instruction retiring is the one in the ID stage. The events go to the
+    // CallProfiler instance set with call_profiler_set().
+    import "DPI-C" function void call_profiler_event(
+      chandle profiler, bit trap, int unsigned pc, int unsigned insn, int unsigned target,
+      longint unsigned cycles, longint unsigned instret, longint unsigned loads,
+      longint unsigned stores, longint unsigned branches_taken,
+      longint unsigned mul_wait, longint unsigned div_wait);
+
+    export "DPI-C" function call_profiler_set;
+
+    bit          call_profiler_en;
+    chandle      call_profiler_handle;
+    bit          call_profiler_pending;
+    bit          call_profiler_trap;
+    logic [31:0] call_profiler_pc;
+    logic [31:0] call_profiler_insn;
+    logic [31:0] call_profiler_ret_insn;
+
+    initial begin
+      call_profiler_en      = 1'b0;
+      call_profiler_pending = 1'b0;
+    end
+
+    function automatic void call_profiler_set(bit enable, chandle profiler);
+      call_profiler_en     = enable;
+      call_profiler_handle = profiler;
+    endfunction
+
+    // Is insn a jal, jalr, c.j, c.jal, c.jr, c.jalr or mret?
+    function automatic bit call_profiler_is_jump(logic [31:0] insn);
+      if (insn[1:0] == 2'b11) begin
+        return insn[6:0] == 7'h6f || insn[6:0] == 7'h67 || insn == 32'h30200073;
+      end
+      return (insn[1:0] == 2'b01 && insn[14:13] == 2'b01) ||
+             (insn[1:0] == 2'b10 && insn[15:13] == 3'b100 && insn[11:7] != '0 &&
+              insn[6:2] == '0);
+    endfunction
+
+    assign call_profiler_ret_insn = u_top.u_ibex_core.instr_is_compressed_id ?
+        {16'b0, u_top.u_ibex_core.instr_rdata_c_id} : u_top.u_ibex_core.instr_rdata_id;
+
+    always @(posedge clk_sys_i) begin
+      if (!rst_sys_ni) begin
+        call_profiler_pending <= 1'b0;
+      end else if (call_profiler_en) begin
+        if (u_top.u_ibex_core.csr_save_cause) begin
+          // Trap entry, reported with the first instruction of the handler
+          call_profiler_pending <= 1'b1;
+          call_profiler_trap    <= 1'b1;
+          call_profiler_pc      <= u_top.u_ibex_core.pc_id;
+          call_profiler_insn    <= '0;
+        end else if (u_top.u_ibex_core.perf_instr_ret_wb) begin
+          if (call_profiler_pending) begin
+            call_profiler_event(call_profiler_handle, call_profiler_trap, call_profiler_pc,
+                                call_profiler_insn, u_top.u_ibex_core.pc_id,
+                                u_top.u_ibex_core.cs_registers_i.mhpmcounter[0],
+                                u_top.u_ibex_core.cs_registers_i.mhpmcounter[2],
+                                u_top.u_ibex_core.cs_registers_i.mhpmcounter[5],
+                                u_top.u_ibex_core.cs_registers_i.mhpmcounter[6],
+                                u_top.u_ibex_core.cs_registers_i.mhpmcounter[9],
+                                u_top.u_ibex_core.cs_registers_i.mhpmcounter[11],
+                                u_top.u_ibex_core.cs_registers_i.mhpmcounter[12]);
+            call_profiler_pending <= 1'b0;
+          end
+          if (call_profiler_is_jump(call_profiler_ret_insn)) begin
+            call_profiler_pending <= 1'b1;
+            call_profiler_trap    <= 1'b0;
+            call_profiler_pc      <= u_top.u_ibex_core.pc_id;
+            call_profiler_insn    <= call_profiler_ret_insn;
+          end
+        end
+      end
+    end
+
+`ifdef RVFI
+    // Retired instructions and data bus transactions for the flight recorder,
+    // see dv/verilator/flight_recorder.cc. Each bus transaction is reported at
+    // its response, with the cycle of its request. Cycles count from the end
+    // of the reset, like the cycles of ibex_tracer.
+    import "DPI-C" function void flight_recorder_retire(
+      chandle recorder, longint unsigned time_val, int unsigned cycle, int unsigned pc_rdata,
+      int unsigned pc_wdata, int unsigned insn, int unsigned rs1_addr, int unsigned rs1_rdata,
+      int unsigned rs2_addr, int unsigned rs2_rdata, int unsigned rs3_addr,
+      int unsigned rs3_rdata, int unsigned rd_addr, int unsigned rd_wdata,
+      int unsigned mem_addr, int unsigned mem_rmask, int unsigned mem_wmask,
+      int unsigned mem_rdata, int unsigned mem_wdata);
+    import "DPI-C" function void flight_recorder_bus(
+      chandle recorder, int unsigned req_cycle, int unsigned resp_cycle, int host, int device,
+      bit we, int unsigned be, int unsigned addr, int unsigned data, bit err);
+
+    export "DPI-C" function flight_recorder_set;
+
+    bit          flight_recorder_retire_en;
+    bit          flight_recorder_bus_en;
+    chandle      flight_recorder_handle;
+    int unsigned flight_recorder_cycle;
+    bit          flight_recorder_pending [NrHosts];
+    int unsigned flight_recorder_req_cycle [NrHosts];
+    int          flight_recorder_device [NrHosts];
+    bit          flight_recorder_we [NrHosts];
+    logic [3:0]  flight_recorder_be [NrHosts];
+    logic [31:0] flight_recorder_addr [NrHosts];
+    logic [31:0] flight_recorder_wdata [NrHosts];
+
+    initial begin
+      flight_recorder_retire_en = 1'b0;
+      flight_recorder_bus_en    = 1'b0;
+      for (int h = 0; h < NrHosts; h++) begin
+        flight_recorder_pending[h] = 1'b0;
+      end
+    end
+
+    // Returns whether the design records anything, it doesn't without RVFI.
+    function automatic bit flight_recorder_set(bit retire_enable, bit bus_enable,
+                                               chandle recorder);
+      flight_recorder_retire_en = retire_enable;
+      flight_recorder_bus_en    = bus_enable;
+      flight_recorder_handle    = recorder;
+      return 1'b1;
+    endfunction
+
+    function automatic int flight_recorder_device_idx();
+      for (int d = 0; d < NrDevices; d++) begin
+        if (device_req[d]) begin
+          return d;
+        end
+      end
+      return NrDevices;
+    endfunction
+
+    always @(posedge clk_sys_i or negedge rst_sys_ni) begin
+      if (!rst_sys_ni) begin
+        flight_recorder_cycle <= 0;
+      end else begin
+        flight_recorder_cycle <= flight_recorder_cycle + 1;
+      end
+    end
+
+    always @(posedge clk_sys_i) begin
+      if (flight_recorder_retire_en && rvfi_valid) begin
+        flight_recorder_retire(flight_recorder_handle, $time, flight_recorder_cycle,
+                               rvfi_pc_rdata, rvfi_pc_wdata, rvfi_insn, 32'(rvfi_rs1_addr),
+                               rvfi_rs1_rdata, 32'(rvfi_rs2_addr), rvfi_rs2_rdata,
+                               32'(rvfi_rs3_addr), rvfi_rs3_rdata, 32'(rvfi_rd_addr),
+                               rvfi_rd_wdata, rvfi_mem_addr, 32'(rvfi_mem_rmask),
+                               32'(rvfi_mem_wmask), rvfi_mem_rdata, rvfi_mem_wdata);
+      end
+      if (!rst_sys_ni) begin
+        for (int h = 0; h < NrHosts; h++) begin
+          flight_recorder_pending[h] <= 1'b0;
+        end
+      end else if (flight_recorder_bus_en) begin
+        for (int h = 0; h < NrHosts; h++) begin
+          if (flight_recorder_pending[h] && host_rvalid[h]) begin
+            flight_recorder_bus(flight_recorder_handle, flight_recorder_req_cycle[h],
+                                flight_recorder_cycle, h, flight_recorder_device[h],
+                                flight_recorder_we[h], 32'(flight_recorder_be[h]),
+                                flight_recorder_addr[h],
+                                flight_recorder_we[h] ? flight_recorder_wdata[h] : host_rdata[h],
+                                host_err[h]);
+            flight_recorder_pending[h] <= 1'b0;
+          end
+          if (host_req[h] && host_gnt[h]) begin
+            flight_recorder_pending[h]   <= 1'b1;
+            flight_recorder_req_cycle[h] <= flight_recorder_cycle;
+            flight_recorder_device[h]    <= flight_recorder_device_idx();
+            flight_recorder_we[h]        <= host_we[h];
+            flight_recorder_be[h]        <= host_be[h];
+            flight_recorder_addr[h]      <= host_addr[h];
+            flight_recorder_wdata[h]     <= host_wdata[h];
+          end
+        end
+      end
+    end
+`else
+    export "DPI-C" function flight_recorder_set;
+
+    function automatic bit flight_recorder_set(bit retire_enable, bit bus_enable,
+                                               chandle recorder);
+      return 1'b0;
+    endfunction
+`endif
+
+    export "DPI-C" function sleep_skippable_cycles;
+
+    // Number of cycles the simulation can skip because the core sleeps and
+    // nothing but the timer interrupt can wake it up, see
+    // dv/verilator/sleep_fast_forward.cc. The timer interrupt still rises in
+    // the same cycle as without skipping. Returns 0 while the core is awake or
+    // any other wake-up source or peripheral is active.
+    function automatic longint unsigned sleep_skippable_cycles();
+      ibex_pkg::irqs_t mie;
+      mie = u_top.u_ibex_core.cs_registers_i.mie_q;
+
+      if (!core_sleep || !mie.irq_timer || timer_irq || uart_irq || dm_debug_req) begin
+        return '0;
+      end
+
+      // UART and SPI states are compared against IDLE ('0).
+      if (u_uart.tx_fifo_rvalid || (u_uart.tx_state_q != '0) || (u_uart.rx_state_q != '0) ||
+          !u_spi.tx_fifo_empty || (u_spi.u_spi_host.state_q != '0)) begin
+        return '0;
+      end
+
+      if (u_timer.mtime_q >= u_timer.mtimecmp_q) begin
+        return '0;
+      end
+
+      // Stop one cycle before mtime reaches mtimecmp, the timer raises the
+      // interrupt in the cycle after.
+      return u_timer.mtimecmp_q - u_timer.mtime_q - 1;
+    endfunction
   `endif
 endmodule
@@ -49,6 +49,8 @@ void puthex(uint32_t h) {
 
 void sim_halt() { DEV_WRITE(SIM_CTRL_BASE + SIM_CTRL_CTRL, 1); }
 
+void sim_fail() { DEV_WRITE(SIM_CTRL_BASE + SIM_CTRL_CTRL, 2); }
+
 unsigned int get_mepc() {
   uint32_t result;
   __asm__ volatile("csrr %0, mepc;" : "=r"(result));
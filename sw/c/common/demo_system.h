@@ -8,6 +8,7 @@
 #include <stdint.h>
 
 #include "demo_system_regs.h"
+#include "dev_access.h"
 #include "gpio.h"
 #include "uart.h"
 
@@ -50,6 +51,37 @@ int getchar(void);
  */
 void sim_halt();
 
+/**
+ * Immediately halts the simulation and reports a failure, e.g. when a check
+ * of the software fails. The simulation ends with an error status and, if
+ * enabled, dumps its flight recorder. Like sim_halt(), only use this in
+ * simulation.
+ */
+void sim_fail();
+
+/**
+ * Begins a measurement region of the simulator. The simulator reports the
+ * cycles and performance counter events between perf_region_begin() and
+ * perf_region_end() with the same `id` at the end of the simulation. Like
+ * sim_halt(), only use this in simulation.
+ *
+ * Inline so the region only includes a single store at each end.
+ *
+ * @param id Region ID, any value chosen by the software
+ */
+static inline void perf_region_begin(uint32_t id) {
+  DEV_WRITE(SIM_CTRL_BASE + SIM_CTRL_REGION_BEGIN, id);
+}
+
+/**
+ * Ends the measurement region `id`, see perf_region_begin().
+ *
+ * @param id Region ID passed to perf_region_begin()
+ */
+static inline void perf_region_end(uint32_t id) {
+  DEV_WRITE(SIM_CTRL_BASE + SIM_CTRL_REGION_END, id);
+}
+
 /**
  * Writes string to default UART. Signature matches c stdlib function of
  * the same name.
@@ -18,5 +18,7 @@
 #define SIM_CTRL_BASE 0x20000
 #define SIM_CTRL_OUT 0x0
 #define SIM_CTRL_CTRL 0x8
+#define SIM_CTRL_REGION_BEGIN 0x10
+#define SIM_CTRL_REGION_END 0x18
 
 #endif
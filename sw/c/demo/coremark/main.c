@@ -0,0 +1,20 @@
+// Copyright lowRISC contributors.
+// Licensed under the Apache License, Version 2.0, see LICENSE for details.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "demo_system.h"
+
+int coremark_main();
+
+// The CoreMark port of the LCD demo prints its results on the LCD, print them
+// to the UART instead.
+void fbcon_putstr(const char *str) { puts(str); }
+
+int main(void) {
+  coremark_main();
+  puts("\n");
+
+  sim_halt();
+
+  return 0;
+}
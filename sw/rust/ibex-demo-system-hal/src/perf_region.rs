@@ -0,0 +1,40 @@
+// Copyright lowRISC contributors.
+// Licensed under the Apache License, Version 2.0, see LICENSE for details.
+// SPDX-License-Identifier: Apache-2.0
+
+//! Measurement regions of the simulator, see `perf_region_begin()` in
+//! `sw/c/common/demo_system.h`. The simulator reports the cycles and
+//! performance counter events of each region at the end of the simulation.
+//! The registers only exist in simulation.
+
+const SIM_CTRL_BASE: usize = 0x20000;
+const SIM_CTRL_REGION_BEGIN: usize = 0x10;
+const SIM_CTRL_REGION_END: usize = 0x18;
+
+/// Begins the measurement region `id`.
+#[inline(always)]
+pub fn begin(id: u32) {
+    // SAFETY: The simulator control registers are write only and have no
+    // effect on the software.
+    unsafe {
+        core::ptr::write_volatile((SIM_CTRL_BASE + SIM_CTRL_REGION_BEGIN) as *mut u32, id);
+    }
+}
+
+/// Ends the measurement region `id`.
+#[inline(always)]
+pub fn end(id: u32) {
+    // SAFETY: See `begin()`.
+    unsafe {
+        core::ptr::write_volatile((SIM_CTRL_BASE + SIM_CTRL_REGION_END) as *mut u32, id);
+    }
+}
+
+/// Runs `f` in the measurement region `id`.
+#[inline(always)]
+pub fn measure<R>(id: u32, f: impl FnOnce() -> R) -> R {
+    begin(id);
+    let result = f();
+    end(id);
+    result
+}
@@ -0,0 +1,121 @@
+#!/usr/bin/env python3
+# Copyright lowRISC contributors.
+# Licensed under the Apache License, Version 2.0, see LICENSE for details.
+# SPDX-License-Identifier: Apache-2.0
+
+'''Convert a binary performance counter series into CSV.
+
+The simulator writes the series with --pcount-interval=CYCLES, see
+dv/verilator/pcount_series.h for the format. The CSV has the same columns as
+the CSV written by the simulator: the cycle at the end of each interval, the
+number of cycles in the interval, the increment of each counter, the IPC and
+the fractions of the cycles stalled on the LSU, fetch, multiplier and divider.
+
+'''
+
+import argparse
+import struct
+import sys
+
+MAGIC = b'IBXPCS1\n'
+
+# Counter indices of the instructions retired and the stall counters
+INSTRET_COUNTER = 2
+STALL_COUNTERS = [3, 4, 11, 12]
+
+
+def read_leb128(data, pos):
+    '''Read an unsigned LEB128 number at data[pos:]
+
+    Returns the number and the position after it.
+
+    '''
+    value = 0
+    shift = 0
+    while True:
+        if pos >= len(data):
+            raise ValueError('Truncated record')
+        byte = data[pos]
+        pos += 1
+        value |= (byte & 0x7f) << shift
+        shift += 7
+        if not byte & 0x80:
+            return value, pos
+
+
+def read_series(data):
+    '''Parse a binary series, return the start cycle, counters and records
+
+    The counters are (index, name) pairs, each record a list of the cycles and
+    the counter increments of one interval.
+
+    '''
+    if not data.startswith(MAGIC):
+        raise ValueError('Not a performance counter series')
+    pos = len(MAGIC)
+    _interval, start_cycle, num_counters = struct.unpack_from('<IQI', data,
+                                                              pos)
+    pos += 16
+
+    counters = []
+    for _ in range(num_counters):
+        index, name_len = data[pos], data[pos + 1]
+        pos += 2
+        counters.append((index, data[pos:pos + name_len].decode()))
+        pos += name_len
+
+    records = []
+    while pos < len(data):
+        record = []
+        for _ in range(num_counters + 1):
+            value, pos = read_leb128(data, pos)
+            record.append(value)
+        records.append(record)
+
+    return start_cycle, counters, records
+
+
+def column_name(name):
+    return name.lower().replace(' ', '_')
+
+
+def write_csv(start_cycle, counters, records, out):
+    indices = [index for index, _ in counters]
+    stall_cols = [indices.index(i) for i in STALL_COUNTERS if i in indices]
+    instret_col = indices.index(INSTRET_COUNTER)
+
+    header = ['cycle', 'interval_cycles']
+    header += [column_name(name) for _, name in counters]
+    header.append('ipc')
+    header += [column_name(counters[col][1]) + '_fraction'
+               for col in stall_cols]
+    out.write(','.join(header) + '\n')
+
+    cycle = start_cycle
+    for cycles, *deltas in records:
+        cycle += cycles
+        row = [str(value) for value in [cycle, cycles] + deltas]
+        # Format the ratios like the simulator does
+        ratios = [deltas[instret_col]] + [deltas[col] for col in stall_cols]
+        row += ['%g' % (value / cycles if cycles else 0.0) for value in ratios]
+        out.write(','.join(row) + '\n')
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split('\n')[0])
+    parser.add_argument('series', help='Binary series (PREFIX.bin)')
+    parser.add_argument('-o', '--output', help='CSV file (default: stdout)')
+    args = parser.parse_args()
+
+    with open(args.series, 'rb') as f:
+        series = read_series(f.read())
+
+    if args.output:
+        with open(args.output, 'w') as out:
+            write_csv(*series, out)
+    else:
+        write_csv(*series, sys.stdout)
+
+
+if __name__ == '__main__':
+    main()
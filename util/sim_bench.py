@@ -0,0 +1,366 @@
+#!/usr/bin/env python3
+# Copyright lowRISC contributors.
+# Licensed under the Apache License, Version 2.0, see LICENSE for details.
+# SPDX-License-Identifier: Apache-2.0
+
+'''Benchmarks for the Verilator simulation of the Ibex Demo System.
+
+Each subcommand runs a built simulator binary a number of times with
+different options and prints a table comparing the simulation statistics of
+the runs. Build the simulator and the software first, see README.md.
+
+'''
+
+import argparse
+import os
+import re
+import shutil
+import struct
+import subprocess
+import sys
+import tempfile
+from pathlib import Path
+
+CORE = 'lowrisc:ibex:demo_system'
+BUILD_DIR = Path('build/lowrisc_ibex_demo_system_0')
+
+
+def sim_work_dir(target):
+    '''FuseSoC work directory of a Verilator target of the demo system'''
+    return BUILD_DIR / '{}-verilator'.format(target)
+
+
+def sim_binary(target):
+    '''Simulator binary built for a Verilator target of the demo system'''
+    return sim_work_dir(target) / 'Vtop_verilator'
+
+
+DEFAULT_SIM = sim_binary('sim')
+
+DEFAULT_TRACE_ELFS = [
+    Path('sw/c/build/demo/hello_world/demo'),
+    Path('sw/c/build/demo/lcd_st7735/lcd_st7735'),
+]
+
+DEFAULT_TARGET_ELFS = [
+    Path('sw/c/build/demo/hello_world/demo'),
+    Path('sw/c/build/demo/coremark/coremark_bench'),
+]
+
+# Simulation targets compared by the targets benchmark. sim_pgo is trained
+# with the software given by --train-elf.
+SIM_TARGETS = ['sim', 'sim_fast', 'sim_mt', 'sim_pgo']
+
+# Trace scopes compared by the trace benchmark, as (name, simulator args)
+TRACE_CONFIGS = [
+    ('none', []),
+    ('full', []),
+    ('bus+spi', ['--trace-scope=u_ibex_demo_system.u_bus,'
+                 'u_ibex_demo_system.u_spi']),
+    ('depth 2', ['--trace-depth=2']),
+]
+
+STAT_RES = {
+    'cycles': re.compile(r'^Executed cycles:\s+(\d+)', re.MULTILINE),
+    'wallclock_s': re.compile(r'^Wallclock time:\s+([\d.e+-]+) s',
+                              re.MULTILINE),
+    'cycles_per_s': re.compile(r'^Simulation speed:\s+([\d.e+-]+) cycles/s',
+                               re.MULTILINE),
+}
+
+# Statistics which are only printed by some simulation runs
+OPTIONAL_STAT_RES = {
+    'trace_size_b': re.compile(r'^Trace file size:\s+(\d+) B', re.MULTILINE),
+    'load_ms': re.compile(r'^Loaded `.*\' in ([\d.e+-]+) ms', re.MULTILINE),
+}
+
+# Image sizes loaded by the load benchmark, in KiB. The RAM holds 4 MiB.
+LOAD_SIZES_KIB = [128, 1024, 4096]
+
+
+def run_sim(sim, args, verbose=False):
+    '''Run the simulator with args and return its statistics as a dict'''
+    cmd = [str(sim)] + [str(arg) for arg in args]
+    if verbose:
+        print('Running: ' + ' '.join(cmd), file=sys.stderr)
+
+    proc = subprocess.run(cmd,
+                          stdout=subprocess.PIPE,
+                          stderr=subprocess.STDOUT,
+                          universal_newlines=True)
+    if proc.returncode != 0:
+        raise RuntimeError('Simulation failed: {}\n{}'.format(
+            ' '.join(cmd), proc.stdout))
+
+    stats = {}
+    for name, stat_re in STAT_RES.items():
+        match = stat_re.search(proc.stdout)
+        if match is None:
+            raise RuntimeError('No "{}" in simulation output of: {}'.format(
+                name, ' '.join(cmd)))
+        stats[name] = float(match.group(1))
+    for name, stat_re in OPTIONAL_STAT_RES.items():
+        match = stat_re.search(proc.stdout)
+        stats[name] = None if match is None else float(match.group(1))
+    return stats
+
+
+def print_table(header, rows):
+    '''Print rows (lists of strings) as a table with aligned columns'''
+    widths = [max(len(row[i]) for row in [header] + rows)
+              for i in range(len(header))]
+    print('  '.join(h.ljust(w) for h, w in zip(header, widths)))
+    print('  '.join('-' * w for w in widths))
+    for row in rows:
+        print('  '.join(c.rjust(w) for c, w in zip(row, widths)))
+
+
+def bench_extensions(args):
+    '''Measure the cost of calling simulation controller extensions'''
+    rows = []
+    for period in args.periods:
+        for num in args.extensions:
+            stats = run_sim(args.sim, [
+                '--meminit=ram,{}'.format(args.elf),
+                '--term-after-cycles={}'.format(args.cycles),
+                '--bench-extensions={},{}'.format(num, period),
+            ], args.verbose)
+            rows.append([
+                str(num),
+                str(period),
+                '{:.0f}'.format(stats['cycles_per_s']),
+            ])
+
+    print_table(['Extensions', 'Period', 'Cycles/s'], rows)
+
+
+def bench_trace(args):
+    '''Compare wallclock time and trace size of full and scoped tracing'''
+    rows = []
+    with tempfile.TemporaryDirectory() as tmpdir:
+        trace_file = Path(tmpdir) / 'sim.fst'
+        for elf in args.elfs:
+            for name, trace_args in TRACE_CONFIGS:
+                sim_args = [
+                    '--meminit=ram,{}'.format(elf),
+                    '--term-after-cycles={}'.format(args.cycles),
+                ]
+                if name != 'none':
+                    sim_args += ['--trace={}'.format(trace_file)] + trace_args
+                stats = run_sim(args.sim, sim_args, args.verbose)
+                size = stats['trace_size_b']
+                rows.append([
+                    elf.name,
+                    name,
+                    '{:.2f}'.format(stats['wallclock_s']),
+                    '{:.0f}'.format(stats['cycles_per_s']),
+                    '-' if size is None else '{:.0f}'.format(size / 1024),
+                ])
+
+    print_table(['Software', 'Trace', 'Wallclock/s', 'Cycles/s', 'Size/KiB'],
+                rows)
+
+
+def write_image_elf(path, size, base_addr=0):
+    '''Write a 32-bit RISC-V ELF file with one segment of size random bytes'''
+    ehdr_size = 52
+    phdr_size = 32
+    data_offset = ehdr_size + phdr_size
+    ehdr = struct.pack(
+        '<4sBBBB8xHHIIIIIHHHHHH',
+        b'\x7fELF', 1, 1, 1, 0,  # ELFCLASS32, ELFDATA2LSB, EV_CURRENT
+        2, 243, 1,  # ET_EXEC, EM_RISCV, EV_CURRENT
+        base_addr, ehdr_size, 0, 0,  # entry, phoff, shoff, flags
+        ehdr_size, phdr_size, 1, 0, 0, 0)
+    phdr = struct.pack(
+        '<IIIIIIII',
+        1, data_offset, base_addr, base_addr,  # PT_LOAD
+        size, size, 7, 4)  # filesz, memsz, RWX, align
+    with open(path, 'wb') as elf:
+        elf.write(ehdr + phdr + os.urandom(size))
+
+
+def bench_load(args):
+    '''Measure the time taken to load images of different sizes into RAM'''
+    rows = []
+    with tempfile.TemporaryDirectory() as tmpdir:
+        for size_kib in args.sizes:
+            elf = Path(tmpdir) / 'image_{}k.elf'.format(size_kib)
+            write_image_elf(elf, size_kib * 1024)
+            load_ms = []
+            for _ in range(args.repeat):
+                stats = run_sim(args.sim, [
+                    '--meminit=ram,{}'.format(elf),
+                    '--verbose-mem-load',
+                    '--term-after-cycles=1',
+                ], args.verbose)
+                if stats['load_ms'] is None:
+                    raise RuntimeError('No load time in simulation output')
+                load_ms.append(stats['load_ms'])
+            best_ms = min(load_ms)
+            rows.append([
+                str(size_kib),
+                '{:.1f}'.format(best_ms),
+                '{:.1f}'.format(size_kib / 1024 / (best_ms / 1000)),
+            ])
+
+    print_table(['Size/KiB', 'Load/ms', 'MiB/s'], rows)
+
+
+def fusesoc(target, stages, verbose=False):
+    '''Run FuseSoC stages (e.g. --setup, --build) for a simulation target'''
+    cmd = ['fusesoc', '--cores-root=.', 'run', '--target=' + target,
+           '--tool=verilator'] + stages + [CORE]
+    if verbose:
+        print('Running: ' + ' '.join(cmd), file=sys.stderr)
+    proc = subprocess.run(cmd,
+                          stdout=subprocess.PIPE,
+                          stderr=subprocess.STDOUT,
+                          universal_newlines=True)
+    if proc.returncode != 0:
+        raise RuntimeError('Building {} failed:\n{}'.format(
+            target, proc.stdout))
+
+
+def build_pgo(args):
+    '''Build sim_pgo, trained by running args.train_elf on sim_pgo_gen'''
+    fusesoc('sim_pgo_gen', ['--setup', '--build'], args.verbose)
+    gen_dir = sim_work_dir('sim_pgo_gen')
+    for old_profile in gen_dir.glob('*.gcda'):
+        old_profile.unlink()
+    run_sim(sim_binary('sim_pgo_gen'), [
+        '--meminit=ram,{}'.format(args.train_elf),
+        '--term-after-cycles={}'.format(args.cycles),
+    ], args.verbose)
+
+    # The profiles are looked up next to the object files
+    fusesoc('sim_pgo', ['--setup'], args.verbose)
+    for profile in gen_dir.glob('*.gcda'):
+        shutil.copy(profile, sim_work_dir('sim_pgo'))
+    fusesoc('sim_pgo', ['--build'], args.verbose)
+
+
+def bench_targets(args):
+    '''Compare the simulation speed of the Verilator build targets'''
+    if not args.no_build:
+        for target in args.targets:
+            if target == 'sim_pgo':
+                build_pgo(args)
+            else:
+                fusesoc(target, ['--setup', '--build'], args.verbose)
+
+    rows = []
+    for target in args.targets:
+        row = [target]
+        for elf in args.elfs:
+            stats = run_sim(sim_binary(target), [
+                '--meminit=ram,{}'.format(elf),
+                '--term-after-cycles={}'.format(args.cycles),
+            ], args.verbose)
+            row.append('{:.0f}'.format(stats['cycles_per_s']))
+        rows.append(row)
+
+    print_table(['Target'] + ['{} cycles/s'.format(elf.name)
+                              for elf in args.elfs], rows)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument('--sim',
+                        type=Path,
+                        default=DEFAULT_SIM,
+                        help='Simulator binary (default: %(default)s)')
+    parser.add_argument('--verbose',
+                        '-v',
+                        action='store_true',
+                        help='Print the simulator commands being run')
+    subparsers = parser.add_subparsers(dest='command', required=True)
+
+    ext_parser = subparsers.add_parser(
+        'extensions', help='Simulation speed with registered extensions')
+    ext_parser.add_argument('elf', type=Path, help='Software to simulate')
+    ext_parser.add_argument('--cycles',
+                            type=int,
+                            default=2000000,
+                            help='Cycles to simulate (default: %(default)s)')
+    ext_parser.add_argument('--extensions',
+                            type=int,
+                            nargs='+',
+                            default=[0, 1, 8],
+                            help='Numbers of extensions to register '
+                            '(default: %(default)s)')
+    ext_parser.add_argument('--periods',
+                            type=int,
+                            nargs='+',
+                            default=[1, 1000],
+                            help='Cycles between calls to each extension '
+                            '(default: %(default)s)')
+    ext_parser.set_defaults(func=bench_extensions)
+
+    trace_parser = subparsers.add_parser(
+        'trace', help='Simulation speed and trace size with scoped tracing')
+    trace_parser.add_argument('elfs',
+                              type=Path,
+                              nargs='*',
+                              default=DEFAULT_TRACE_ELFS,
+                              help='Software to simulate (default: '
+                              'hello_world and lcd_st7735 demos)')
+    trace_parser.add_argument('--cycles',
+                              type=int,
+                              default=2000000,
+                              help='Cycles to simulate (default: %(default)s)')
+    trace_parser.set_defaults(func=bench_trace)
+
+    targets_parser = subparsers.add_parser(
+        'targets', help='Build and compare the Verilator build targets')
+    targets_parser.add_argument('elfs',
+                                type=Path,
+                                nargs='*',
+                                default=DEFAULT_TARGET_ELFS,
+                                help='Software to simulate (default: '
+                                'hello_world and CoreMark)')
+    targets_parser.add_argument('--targets',
+                                nargs='+',
+                                choices=SIM_TARGETS,
+                                default=SIM_TARGETS,
+                                help='Targets to compare (default: all)')
+    targets_parser.add_argument('--cycles',
+                                type=int,
+                                default=10000000,
+                                help='Cycles to simulate (default: '
+                                '%(default)s)')
+    targets_parser.add_argument('--train-elf',
+                                type=Path,
+                                default=DEFAULT_TARGET_ELFS[1],
+                                help='Software to train sim_pgo with '
+                                '(default: %(default)s)')
+    targets_parser.add_argument('--no-build',
+                                action='store_true',
+                                help='Use the simulators built before')
+    targets_parser.set_defaults(func=bench_targets)
+
+    load_parser = subparsers.add_parser(
+        'load', help='Time taken to load images into the RAM')
+    load_parser.add_argument('--sizes',
+                             type=int,
+                             nargs='+',
+                             default=LOAD_SIZES_KIB,
+                             help='Image sizes in KiB (default: %(default)s)')
+    load_parser.add_argument('--repeat',
+                             type=int,
+                             default=3,
+                             help='Loads per size, the fastest is reported '
+                             '(default: %(default)s)')
+    load_parser.set_defaults(func=bench_load)
+
+    args = parser.parse_args()
+    try:
+        args.func(args)
+    except RuntimeError as err:
+        print('ERROR: {}'.format(err), file=sys.stderr)
+        return 1
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,126 @@
+#!/usr/bin/env python3
+# Copyright lowRISC contributors.
+# Licensed under the Apache License, Version 2.0, see LICENSE for details.
+# SPDX-License-Identifier: Apache-2.0
+
+'''Run software on a simulator started in sim server mode.
+
+Start the simulator with --server=SOCKET first. Each ELF file is simulated
+as one job; the UART output and the performance counters of each job are
+written next to each other into the output directory.
+
+The protocol is line based. A request is one line of KEY=VALUE parameters:
+
+    elf=PATH [cycles=N] [uart_input=PATH]
+
+The server answers with
+
+    status 0|1
+    cycles N
+    uart LENGTH
+    <LENGTH bytes of UART output>
+    pcount LENGTH
+    <LENGTH bytes of performance counters as CSV>
+
+or a single line "error MESSAGE". The request "quit" stops the server.
+
+'''
+
+import argparse
+import socket
+import sys
+from pathlib import Path
+
+
+class SimClient:
+    '''Connection to a simulator in sim server mode'''
+
+    def __init__(self, path):
+        self.sock = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+        self.sock.connect(str(path))
+        self.file = self.sock.makefile('rb')
+
+    def _read_line(self):
+        line = self.file.readline()
+        if not line:
+            raise RuntimeError('Connection closed by the simulator')
+        return line.decode().rstrip('\n')
+
+    def _read_field(self, name):
+        key, _, value = self._read_line().partition(' ')
+        if key == 'error':
+            raise RuntimeError(value)
+        if key != name:
+            raise RuntimeError('Expected "{}", got "{}"'.format(name, key))
+        return value
+
+    def run(self, elf, cycles=None, uart_input=None):
+        '''Run a job, return (status, cycles, uart output, pcount CSV)'''
+        request = 'elf={}'.format(Path(elf).resolve())
+        if cycles is not None:
+            request += ' cycles={}'.format(cycles)
+        if uart_input is not None:
+            request += ' uart_input={}'.format(Path(uart_input).resolve())
+        self.sock.sendall((request + '\n').encode())
+
+        status = int(self._read_field('status'))
+        sim_cycles = int(self._read_field('cycles'))
+        uart = self.file.read(int(self._read_field('uart')))
+        pcount = self.file.read(int(self._read_field('pcount')))
+        return status, sim_cycles, uart, pcount
+
+    def quit(self):
+        '''Stop the server'''
+        self.sock.sendall(b'quit\n')
+
+    def close(self):
+        self.file.close()
+        self.sock.close()
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description=__doc__,
+        formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('socket', type=Path, help='Socket of the simulator')
+    parser.add_argument('elfs', type=Path, nargs='*', help='Software to run')
+    parser.add_argument('--cycles',
+                        type=int,
+                        help='Cycle limit of each job (default: the '
+                        'simulator\'s --term-after-cycles)')
+    parser.add_argument('--uart-input',
+                        type=Path,
+                        help='File sent to the UART of the demo system')
+    parser.add_argument('--out-dir',
+                        type=Path,
+                        default=Path('.'),
+                        help='Directory to write <elf>.uart.log and '
+                        '<elf>.pcount.csv to (default: %(default)s)')
+    parser.add_argument('--quit',
+                        action='store_true',
+                        help='Stop the server after the jobs')
+    args = parser.parse_args()
+
+    failed = 0
+    client = SimClient(args.socket)
+    try:
+        for elf in args.elfs:
+            status, cycles, uart, pcount = client.run(elf, args.cycles,
+                                                      args.uart_input)
+            (args.out_dir / (elf.name + '.uart.log')).write_bytes(uart)
+            (args.out_dir / (elf.name + '.pcount.csv')).write_bytes(pcount)
+            print('{}  {:>12} cycles  {}'.format('PASS' if status == 0 else
+                                                 'FAIL', cycles, elf))
+            failed += status != 0
+        if args.quit:
+            client.quit()
+    except RuntimeError as err:
+        print('ERROR: {}'.format(err), file=sys.stderr)
+        return 1
+    finally:
+        client.close()
+    return 1 if failed else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())